@@ -5,8 +5,22 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QtDebug>
-
-AbstractDatabaseAdapter::AbstractDatabaseAdapter(const QString & connectionName) : mConnectionName(connectionName)
+#include <QVector>
+
+#include <algorithm>
+
+AbstractDatabaseAdapter::AbstractDatabaseAdapter(const QString & connectionName) : mConnectionName(connectionName),
+    mBatchTuner(10000, 256, 1 << 20),
+    mCommitTuner(100000, 1000, 1 << 24),
+    mStoreEdgeRanges(false),
+    mMaximumEdgeSpan(0),
+    mSeqCount(-1),
+    mSortEdges(false),
+    mEdgeSortKey(ExternalEdgeSorter::SortByFrom),
+    mEdgeSortMemory(0),
+    mInTransaction(false),
+    mRowsSinceCommit(0),
+    mNsecsSinceCommit(0)
 {
 
 }
@@ -21,19 +35,171 @@ bool AbstractDatabaseAdapter::isOpen() const
     return QSqlDatabase::database(mConnectionName).isOpen();
 }
 
+bool AbstractDatabaseAdapter::writesInBackground() const
+{
+    return false;
+}
+
+QSqlDatabase AbstractDatabaseAdapter::cloneConnection(const QString &name) const
+{
+    QSqlDatabase db = QSqlDatabase::cloneDatabase(mConnectionName, name);
+    if( !db.open() ) {
+        qWarning() << "AbstractDatabaseAdapter::cloneConnection" << db.lastError().text();
+    }
+    return db;
+}
+
 void AbstractDatabaseAdapter::setOtypeRanges(QHash<QString, QPair<unsigned int, unsigned int> > oTypeRanges)
 {
     mOTypeRanges = oTypeRanges;
 }
 
-void AbstractDatabaseAdapter::beginTransaction() const
+void AbstractDatabaseAdapter::beginTransaction()
+{
+    /// don't try to open it: a dump adapter has no connection at all
+    QSqlDatabase::database(mConnectionName, false).transaction();
+    mInTransaction = true;
+    mRowsSinceCommit = 0;
+    mNsecsSinceCommit = 0;
+}
+
+void AbstractDatabaseAdapter::commitTransaction()
+{
+    /// only the statements and the commit are timed; parsing in between is not the database's doing
+    QElapsedTimer timer;
+    timer.start();
+    QSqlDatabase::database(mConnectionName, false).commit();
+    mInTransaction = false;
+    mCommitTuner.record(mRowsSinceCommit, mNsecsSinceCommit + timer.nsecsElapsed());
+    mRowsSinceCommit = 0;
+    mNsecsSinceCommit = 0;
+}
+
+void AbstractDatabaseAdapter::setBatchSize(int rows)
+{
+    if( rows > 0 ) {
+        mBatchTuner.setFixed(rows);
+    }
+}
+
+void AbstractDatabaseAdapter::setCommitSize(int rows)
+{
+    if( rows > 0 ) {
+        mCommitTuner.setFixed(rows);
+    }
+}
+
+int AbstractDatabaseAdapter::batchSize() const
+{
+    return mBatchTuner.value();
+}
+
+int AbstractDatabaseAdapter::commitSize() const
 {
-    QSqlDatabase::database(mConnectionName).transaction();
+    return mCommitTuner.value();
 }
 
-void AbstractDatabaseAdapter::commitTransaction() const
+bool AbstractDatabaseAdapter::batchSizeSettled() const
 {
-    QSqlDatabase::database(mConnectionName).commit();
+    return mBatchTuner.isSettled();
+}
+
+bool AbstractDatabaseAdapter::commitSizeSettled() const
+{
+    return mCommitTuner.isSettled();
+}
+
+void AbstractDatabaseAdapter::setBatchDefaults(int batchSize, int commitSize)
+{
+    if( !mBatchTuner.isFixed() ) {
+        mBatchTuner = ThroughputTuner(batchSize, 256, 1 << 20);
+    }
+    if( !mCommitTuner.isFixed() ) {
+        mCommitTuner = ThroughputTuner(commitSize, 1000, 1 << 24);
+    }
+}
+
+void AbstractDatabaseAdapter::beginLoading()
+{
+}
+
+void AbstractDatabaseAdapter::finishLoading()
+{
+}
+
+bool AbstractDatabaseAdapter::finishImport()
+{
+    return true;
+}
+
+bool AbstractDatabaseAdapter::execStatement(const QString &table, const QString &query)
+{
+    Q_UNUSED(table)
+    return execQuery(query, "AbstractDatabaseAdapter::execStatement");
+}
+
+void AbstractDatabaseAdapter::tableCreated(const QString &table)
+{
+    Q_UNUSED(table)
+}
+
+void AbstractDatabaseAdapter::tableShrunk(const QString &table)
+{
+    Q_UNUSED(table)
+}
+
+bool AbstractDatabaseAdapter::execBatched(const QString &table, const QString &queryString, const QStringList &placeholders, const QList<QVariantList> &columns)
+{
+    Q_UNUSED(table)
+    Q_ASSERT(placeholders.count() == columns.count());
+    Q_ASSERT(!columns.isEmpty());
+
+    QSqlQuery q(QSqlDatabase::database(mConnectionName));
+    if( !q.prepare(queryString) ) {
+        qWarning() << "AbstractDatabaseAdapter::execBatched" << q.lastError().text() << queryString;
+        return false;
+    }
+
+    bool ok = true;
+    const int rowCount = columns.first().count();
+    int offset = 0;
+    while( offset < rowCount ) {
+        const int n = qMin(mBatchTuner.value(), rowCount - offset);
+        for(int i=0; i<columns.count(); i++) {
+            q.bindValue(placeholders.at(i), n == rowCount ? columns.at(i) : columns.at(i).mid(offset, n));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        if( !q.execBatch() ) {
+            qWarning() << "AbstractDatabaseAdapter::execBatched" << q.lastError().text() << q.executedQuery();
+            ok = false;
+        }
+        const qint64 nsecs = timer.nsecsElapsed();
+        mBatchTuner.record(n, nsecs);
+
+        offset += n;
+        rowsWritten(n, nsecs);
+    }
+    return ok;
+}
+
+bool AbstractDatabaseAdapter::execNodeData(const QString &table, const QString &column, const QVariantList &ids, const QVariantList &values)
+{
+    return execBatched( table, insertNodeDataQueryString(table,column), QStringList() << ":value" << ":id", QList<QVariantList>() << values << ids );
+}
+
+void AbstractDatabaseAdapter::rowsWritten(int rows, qint64 nsecs)
+{
+    if( !mInTransaction ) {
+        return;
+    }
+    mRowsSinceCommit += rows;
+    mNsecsSinceCommit += nsecs;
+    if( mRowsSinceCommit >= mCommitTuner.value() ) {
+        commitTransaction();
+        beginTransaction();
+    }
 }
 
 QString AbstractDatabaseAdapter::sqlDataType(TFFile::ValueType t) const
@@ -47,6 +213,39 @@ QString AbstractDatabaseAdapter::sqlDataType(TFFile::ValueType t) const
     }
 }
 
+QString AbstractDatabaseAdapter::sqlDataType(TFFile::ValueType t, const TFFile::Statistics &statistics) const
+{
+    /// without a scan there is nothing to go on
+    if( statistics.rowCount == 0 ) {
+        return sqlDataType(t);
+    }
+
+    switch(t)
+    {
+    case TFFile::ValueTypeString:
+        return stringTypeForLength( statistics.maximumStringLength );
+    case TFFile::ValueTypeInteger:
+        if( statistics.hasIntegers ) {
+            return integerTypeForRange( statistics.minimumInteger, statistics.maximumInteger );
+        }
+        return integerType();
+    }
+    return stringType();
+}
+
+QString AbstractDatabaseAdapter::integerTypeForRange(qint64 minimum, qint64 maximum) const
+{
+    Q_UNUSED(minimum)
+    Q_UNUSED(maximum)
+    return integerType();
+}
+
+QString AbstractDatabaseAdapter::stringTypeForLength(int length) const
+{
+    Q_UNUSED(length)
+    return stringType();
+}
+
 QString AbstractDatabaseAdapter::getOTypeFromNode(unsigned int node) const
 {
     QHashIterator<QString,QPair<unsigned int,unsigned int>> i( mOTypeRanges );
@@ -65,8 +264,29 @@ QString AbstractDatabaseAdapter::getOTypeFromNode(unsigned int node) const
 
 
 
-void AbstractDatabaseAdapter::insertNodeData(const QString &column, const QString &columnType, const QVariantList &ids, const QVariantList &values)
+void AbstractDatabaseAdapter::insertNodeData(const QString &column, const QString &columnType, const QVariantList &unsortedIds, const QVariantList &unsortedValues)
 {
+    /// Rows written in ascending _id order are appended to the end of the
+    /// primary key B-tree, rather than splitting pages all over it. TF files
+    /// are nearly always in order already, so only sort when they aren't.
+    QVariantList ids = unsortedIds;
+    QVariantList values = unsortedValues;
+    bool sorted = true;
+    for(int i=1; i<ids.count() && sorted; i++) {
+        sorted = ids.at(i-1).toUInt() <= ids.at(i).toUInt();
+    }
+    if( !sorted ) {
+        QVector<int> order( ids.count() );
+        for(int i=0; i<order.count(); i++) {
+            order[i] = i;
+        }
+        std::stable_sort( order.begin(), order.end(), [&](int a, int b) { return unsortedIds.at(a).toUInt() < unsortedIds.at(b).toUInt(); } );
+        for(int i=0; i<order.count(); i++) {
+            ids[i] = unsortedIds.at(order.at(i));
+            values[i] = unsortedValues.at(order.at(i));
+        }
+    }
+
     /// the table will be the same for all nodes
     Q_ASSERT(!ids.isEmpty());
 
@@ -96,7 +316,7 @@ void AbstractDatabaseAdapter::insertNodeData(const QString &column, const QStrin
         else
         {
             /// first insert the current data
-            performInsertNodeData( currentTable, column, columnType, short_ids, short_values );
+            performInsertNodeData( tableName(currentTable), column, columnType, short_ids, short_values );
             /// now reset the lists
             short_ids.clear();
             short_values.clear();
@@ -109,7 +329,7 @@ void AbstractDatabaseAdapter::insertNodeData(const QString &column, const QStrin
     }
     if( short_ids.length() > 0 )
     {
-        performInsertNodeData( currentTable, column, columnType, short_ids, short_values );
+        performInsertNodeData( tableName(currentTable), column, columnType, short_ids, short_values );
     }
 }
 
@@ -117,48 +337,151 @@ void AbstractDatabaseAdapter::performInsertNodeData(const QString &table, const
 {
     maybeAddTableColumn(table,column,columnType);
 
-    QSqlQuery q(QSqlDatabase::database(mConnectionName));
-    QString queryString(insertNodeDataQueryString(table,column));
-    if( !q.prepare(queryString) ) {
-        qWarning() << "AbstractDatabaseAdapter::performInsertNodeData" << q.lastError().text() << queryString;
+    if( !execNodeData( table, column, ids, values ) )
+        qWarning() << "AbstractDatabaseAdapter::performInsertNodeData" << table << column;
+}
+
+void AbstractDatabaseAdapter::insertEdgeData(const QString &table, const QVariantList &froms, const QVariantList &tos, const QVariantList &values)
+{
+    if( froms.isEmpty() ) {
         return;
     }
+    if( !execBatched( tableName(table), insertEdgeDataQueryString(tableName(table)), QStringList() << ":from" << ":to" << ":value", QList<QVariantList>() << froms << tos << values ) )
+        qWarning() << "AbstractDatabaseAdapter::insertEdgeData" << table;
+}
 
-    q.bindValue(":value",values);
-    q.bindValue(":id",ids);
-    if( !q.execBatch() )
-        qWarning() << "AbstractDatabaseAdapter::performInsertNodeData" << q.lastError().text() << q.executedQuery();
+void AbstractDatabaseAdapter::setStoreEdgeRanges(bool storeRanges)
+{
+    mStoreEdgeRanges = storeRanges;
 }
 
-void AbstractDatabaseAdapter::insertEdgeData(const QString &table, const QVariantList &froms, const QVariantList &tos, const QVariantList &values) const
+bool AbstractDatabaseAdapter::storesEdgeRanges() const
 {
-    QSqlQuery q(QSqlDatabase::database(mConnectionName));
-    QString queryString(insertEdgeDataQueryString(table));
-    if( !q.prepare(queryString) ) {
-        qWarning() << "AbstractDatabaseAdapter::insertEdgeData" << q.lastError().text() << queryString;
-        return;
+    return mStoreEdgeRanges;
+}
+
+void AbstractDatabaseAdapter::setSortEdges(bool sortEdges, ExternalEdgeSorter::SortKey key, qint64 memoryBytes)
+{
+    mSortEdges = sortEdges;
+    mEdgeSortKey = key;
+    mEdgeSortMemory = memoryBytes > 0 ? memoryBytes : Q_INT64_C(512) * 1024 * 1024;
+}
+
+bool AbstractDatabaseAdapter::sortsEdges() const
+{
+    return mSortEdges;
+}
+
+ExternalEdgeSorter::SortKey AbstractDatabaseAdapter::edgeSortKey() const
+{
+    return mEdgeSortKey;
+}
+
+qint64 AbstractDatabaseAdapter::edgeSortMemory() const
+{
+    return mEdgeSortMemory;
+}
+
+QStringList AbstractDatabaseAdapter::edgeClusterKey() const
+{
+    if( mEdgeSortKey == ExternalEdgeSorter::SortByTo ) {
+        return QStringList() << "to_node" << "from_node";
     }
+    return QStringList() << "from_node" << "to_node";
+}
 
-    q.bindValue(":from", froms);
-    q.bindValue(":to", tos);
-    q.bindValue(":value", values);
+QString AbstractDatabaseAdapter::edgeRangeTableName(const QString &table)
+{
+    return table + "_ranges";
+}
 
-    if( !q.execBatch() )
-        qWarning() << "AbstractDatabaseAdapter::insertNodeData" << q.lastError().text() << q.executedQuery();
+void AbstractDatabaseAdapter::insertEdgeRanges(const QString &table, const QVariantList &fromStarts, const QVariantList &fromEnds, const QVariantList &toStarts, const QVariantList &toEnds, const QVariantList &values)
+{
+    for(int i=0; i<fromStarts.count(); i++) {
+        mMaximumEdgeSpan = qMax( mMaximumEdgeSpan, fromEnds.at(i).toUInt() - fromStarts.at(i).toUInt() + 1 );
+        mMaximumEdgeSpan = qMax( mMaximumEdgeSpan, toEnds.at(i).toUInt() - toStarts.at(i).toUInt() + 1 );
+    }
+    insertRows( edgeRangeTableName(table), QStringList() << "from_start" << "from_end" << "to_start" << "to_end" << "value",
+                QList<QVariantList>() << fromStarts << fromEnds << toStarts << toEnds << values );
 }
 
-void AbstractDatabaseAdapter::createTable(const QString & tableName, const QSet<QString> &columns, const QHash<QString, QString> &columnTypes ) const
+void AbstractDatabaseAdapter::createEdgeRangeView(const QString &table)
 {
-    QSqlQuery q(QSqlDatabase::database(mConnectionName));
+    /// _seq holds 0, 1, 2, ... and is shared by every range view; it is made afresh
+    /// once per run and counted here, since a dump can't be asked what it holds
+    if( mSeqCount < 0 ) {
+        QSet<QString> columns;
+        QHash<QString, QString> columnTypes;
+        columns << "n";
+        columnTypes["n"] = primaryKeyType();
+        execQuery( dropTableQueryString("_seq"), "AbstractDatabaseAdapter::createEdgeRangeView" );
+        execQuery( createTableQueryString("_seq", columns, columnTypes), "AbstractDatabaseAdapter::createEdgeRangeView" );
+        mSeqCount = 0;
+    }
+    if( mSeqCount < mMaximumEdgeSpan ) {
+        QVariantList numbers;
+        numbers.reserve( static_cast<int>(mMaximumEdgeSpan - mSeqCount) );
+        for(qint64 n = mSeqCount; n < mMaximumEdgeSpan; n++) {
+            numbers << n;
+        }
+        execBatched( "_seq", "INSERT INTO `_seq` (`n`) VALUES (:n);", QStringList() << ":n", QList<QVariantList>() << numbers );
+        mSeqCount = mMaximumEdgeSpan;
+    }
 
-    if( !q.exec(dropTableQueryString(tableName)) ) {
-        qWarning() << "AbstractDatabaseAdapter::createTable" << q.lastError().text() << q.lastQuery();
+    const QString view = tableName(table);
+    const QString ranges = tableName( edgeRangeTableName(table) );
+    /// a plain edge table from an earlier run would be in the way
+    dropView(view);
+    execQuery( dropTableQueryString(view), "AbstractDatabaseAdapter::createEdgeRangeView" );
+    execQuery( "CREATE VIEW `" + view + "` AS SELECT r.from_start + f.n AS from_node, r.to_start + t.n AS to_node, r.value AS value FROM `" + ranges + "` r"
+               " JOIN `_seq` f ON f.n <= r.from_end - r.from_start JOIN `_seq` t ON t.n <= r.to_end - r.to_start;",
+               "AbstractDatabaseAdapter::createEdgeRangeView" );
+
+    createIndex( edgeRangeTableName(table), QStringList() << "from_start" << "from_end" );
+    createIndex( edgeRangeTableName(table), QStringList() << "to_start" << "to_end" );
+}
+
+QVariant AbstractDatabaseAdapter::queryValue(const QString &query, const QVariantList &bindValues) const
+{
+    QSqlQuery q(QSqlDatabase::database(mConnectionName));
+    if( !q.prepare(query) ) {
+        qWarning() << "AbstractDatabaseAdapter::queryValue" << q.lastError().text() << query;
+        return QVariant();
+    }
+    foreach( QVariant value, bindValues ) {
+        q.addBindValue(value);
+    }
+    if( !q.exec() ) {
+        qWarning() << "AbstractDatabaseAdapter::queryValue" << q.lastError().text() << query;
+        return QVariant();
     }
+    return q.next() ? q.value(0) : QVariant();
+}
 
-    QString query = createTableQueryString(tableName,columns,columnTypes);
+void AbstractDatabaseAdapter::createIndex(const QString &table, const QStringList &columns)
+{
+    const QString name = tableName(table);
+    QStringList quoted;
+    foreach( QString column, columns ) {
+        quoted << "`" + column + "`";
+    }
+    execStatement( name, "CREATE INDEX `" + name + "_" + columns.join("_") + "` ON `" + name + "` (" + quoted.join(",") + ");" );
+}
 
-    if( !q.exec(query) ) {
-        qWarning() << "AbstractDatabaseAdapter::createTable" << q.lastError().text() << query;
+void AbstractDatabaseAdapter::createTable(const QString & table, const QSet<QString> &columns, const QHash<QString, QString> &columnTypes, const QStringList &clusterKey )
+{
+    const QString name = tableName(table);
+    execStatement( name, dropTableQueryString(name) );
+    if( execStatement( name, createTableQueryString(name,columns,columnTypes) ) ) {
+        /// later inserts won't try to add these again
+        mTableColumns[name] = columns;
+        /// rows without a primary key stay in insertion order, which is already the
+        /// cluster order; the index serves the lookups. It comes before tableCreated,
+        /// which may put off index maintenance until the load is done.
+        if( !clusterKey.isEmpty() ) {
+            createIndex( table, clusterKey );
+        }
+        tableCreated(name);
     }
 }
 
@@ -171,15 +494,13 @@ void AbstractDatabaseAdapter::maybeAddTableColumn(const QString &table, const QS
 
 void AbstractDatabaseAdapter::addTableColumn(const QString &table, const QString &column, const QString &columnType)
 {
-    QSqlQuery q(QSqlDatabase::database(mConnectionName));
-    if( !q.exec(addTableColumnQueryString(table,column,columnType)) ) {
-        qWarning() << "AbstractDatabaseAdapter::addTableColumn" << q.lastError().text() << q.lastQuery();
+    if( !execStatement( table, addTableColumnQueryString(table,column,columnType) ) ) {
         return;
     }
     mTableColumns[table] << column;
 }
 
-void AbstractDatabaseAdapter::createOTypeTable() const
+void AbstractDatabaseAdapter::createOTypeTable()
 {
     QSet<QString> columns;
     columns << "startNode" << "endNode" << "typeLabel";
@@ -190,20 +511,136 @@ void AbstractDatabaseAdapter::createOTypeTable() const
 
     createTable( "otype", columns, columnTypes );
 
-    QSqlQuery q(QSqlDatabase::database(mConnectionName));
-    QString queryString(createOTypeTableQueryString());
-    if( !q.prepare(queryString) ) {
-        qWarning() << "AbstractDatabaseAdapter::createOTypeTable" << q.lastError().text() << queryString;
-        return;
-    }
-
+    QVariantList startNodes, endNodes, typeLabels;
     QHashIterator<QString,QPair<unsigned int,unsigned int>> i( mOTypeRanges );
     while (i.hasNext()) {
         i.next();
-        q.bindValue(":startNode", i.value().first);
-        q.bindValue(":endNode", i.value().second);
-        q.bindValue(":typeLabel",i.key());
-        if( !q.exec() )
-            qWarning() << "AbstractDatabaseAdapter::createOTypeTable" << q.lastError().text() << q.executedQuery();
+        startNodes << i.value().first;
+        endNodes << i.value().second;
+        typeLabels << i.key();
+    }
+
+    const QString table = tableName("otype");
+    if( !execBatched( table, createOTypeTableQueryString(table), QStringList() << ":startNode" << ":endNode" << ":typeLabel", QList<QVariantList>() << startNodes << endNodes << typeLabels ) )
+        qWarning() << "AbstractDatabaseAdapter::createOTypeTable" << table;
+}
+
+void AbstractDatabaseAdapter::insertRows(const QString &table, const QStringList &columns, const QList<QVariantList> &values)
+{
+    Q_ASSERT(columns.count() == values.count());
+    if( values.isEmpty() || values.first().isEmpty() ) {
+        return;
+    }
+
+    QStringList quoted;
+    QStringList placeholders;
+    for(int i=0; i<columns.count(); i++) {
+        quoted << "`" + columns.at(i) + "`";
+        placeholders << ":c" + QString::number(i);
+    }
+    const QString queryString = "INSERT INTO `" + tableName(table) + "` (" + quoted.join(",") + ") VALUES (" + placeholders.join(",") + ");";
+
+    if( !execBatched( tableName(table), queryString, placeholders, values ) )
+        qWarning() << "AbstractDatabaseAdapter::insertRows" << table;
+}
+
+void AbstractDatabaseAdapter::setTableSuffix(const QString &suffix)
+{
+    mTableSuffix = suffix;
+}
+
+QString AbstractDatabaseAdapter::tableName(const QString &name) const
+{
+    return name + mTableSuffix;
+}
+
+QSet<QString> AbstractDatabaseAdapter::tableColumns(const QString &table) const
+{
+    return mTableColumns.value(table);
+}
+
+bool AbstractDatabaseAdapter::execQuery(const QString &query, const char *context) const
+{
+    QSqlQuery q(QSqlDatabase::database(mConnectionName));
+    if( !q.exec(query) ) {
+        qWarning() << context << q.lastError().text() << query;
+        return false;
+    }
+    return true;
+}
+
+void AbstractDatabaseAdapter::dropView(const QString &view) const
+{
+    execQuery( dropViewQueryString(view), "AbstractDatabaseAdapter::dropView" );
+}
+
+void AbstractDatabaseAdapter::renameTable(const QString &from, const QString &to)
+{
+    if( execQuery( "ALTER TABLE `" + from + "` RENAME TO `" + to + "`;", "AbstractDatabaseAdapter::renameTable" ) ) {
+        mTableColumns[to] = mTableColumns.take(from);
+    }
+}
+
+void AbstractDatabaseAdapter::deduplicateAgainstBase(const QString &versionTable, const QString &baseTable, const QString &omapTable, const QPair<unsigned int, unsigned int> &range)
+{
+    QSet<QString> versionColumns = mTableColumns.value(versionTable);
+    QSet<QString> baseColumns = mTableColumns.value(baseTable);
+    versionColumns.remove("_id");
+    baseColumns.remove("_id");
+    const QString inRange = "m.from_node BETWEEN " + QString::number(range.first) + " AND " + QString::number(range.second);
+
+    /// every mapped node gets a row, so that a node with no values in this
+    /// version is not mistaken for a copy of a base node that has values
+    execQuery( "INSERT INTO `" + versionTable + "` (`_id`) SELECT m.from_node FROM `" + omapTable + "` m WHERE " + inRange
+               + " AND m.from_node NOT IN (SELECT `_id` FROM `" + versionTable + "`);", "AbstractDatabaseAdapter::deduplicateAgainstBase" );
+
+    /// a row is shared when every column agrees with the base row (missing columns count as NULL)
+    const QString v = "`" + versionTable + "`.";
+    QStringList sameRow;
+    sameRow << "m.from_node = " + v + "`_id`";
+    foreach(QString column, versionColumns) {
+        if( baseColumns.contains(column) ) {
+            sameRow << nullSafeEqualsString(v + "`" + column + "`", "b.`" + column + "`");
+        } else {
+            sameRow << v + "`" + column + "` IS NULL";
+        }
+    }
+    foreach(QString column, baseColumns) {
+        if( !versionColumns.contains(column) ) {
+            sameRow << "b.`" + column + "` IS NULL";
+        }
+    }
+
+    if( execQuery( "DELETE FROM `" + versionTable + "` WHERE EXISTS (SELECT 1 FROM `" + omapTable + "` m JOIN `" + baseTable + "` b ON b.`_id` = m.to_node WHERE " + sameRow.join(" AND ") + ");",
+                   "AbstractDatabaseAdapter::deduplicateAgainstBase" ) ) {
+        tableShrunk(versionTable);
+    }
+
+    const QString deltaTable = versionTable + "_delta";
+    dropView(versionTable);
+    execQuery( dropTableQueryString(deltaTable), "AbstractDatabaseAdapter::deduplicateAgainstBase" );
+    renameTable(versionTable, deltaTable);
+
+    QStringList deltaSelect;
+    QStringList baseSelect;
+    deltaSelect << "`_id`";
+    baseSelect << "m.from_node AS `_id`";
+    foreach(QString column, versionColumns) {
+        deltaSelect << "`" + column + "`";
+        baseSelect << ( baseColumns.contains(column) ? "b.`" + column + "`" : "NULL" ) + " AS `" + column + "`";
+    }
+
+    execQuery( "CREATE VIEW `" + versionTable + "` AS SELECT " + deltaSelect.join(", ") + " FROM `" + deltaTable + "`"
+               + " UNION ALL SELECT " + baseSelect.join(", ") + " FROM `" + omapTable + "` m JOIN `" + baseTable + "` b ON b.`_id` = m.to_node"
+               + " WHERE " + inRange + " AND m.from_node NOT IN (SELECT `_id` FROM `" + deltaTable + "`);",
+               "AbstractDatabaseAdapter::deduplicateAgainstBase" );
+}
+
+void AbstractDatabaseAdapter::createFullTextIndex(const QString &table, const QStringList &columns, const QString &tokenizer)
+{
+    foreach( QString query, createFullTextIndexQueryStrings(table, columns, tokenizer) ) {
+        if( !execQuery( query, "AbstractDatabaseAdapter::createFullTextIndex" ) ) {
+            return;
+        }
     }
 }
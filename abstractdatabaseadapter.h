@@ -5,8 +5,12 @@
 #include <QHash>
 #include <QSet>
 #include <QSqlQuery>
+#include <QSqlDatabase>
+#include <QElapsedTimer>
 
 #include "tffile.h"
+#include "throughputtuner.h"
+#include "externaledgesorter.h"
 
 typedef QPair<unsigned int, QVariant> NodeValue;
 typedef QPair<unsigned int, unsigned int> Edge;
@@ -18,31 +22,131 @@ public:
     explicit AbstractDatabaseAdapter(const QString &connectionName);
     virtual ~AbstractDatabaseAdapter();
 
-    bool isOpen() const;
+    virtual bool isOpen() const;
+    /// whether writes are handed to other threads, so that the caller is free to
+    /// parse the next files in the meantime
+    virtual bool writesInBackground() const;
 
-    void createTable(const QString & tableName, const QSet<QString> &columns , const QHash<QString, QString> &columnTypes = QHash<QString,QString>()) const;
+    /// a new connection named @name to the same database, for use in the
+    /// thread that calls this; remove it with QSqlDatabase::removeDatabase
+    QSqlDatabase cloneConnection(const QString & name) const;
+
+    /// @clusterKey names the columns the rows will be inserted in the order of; they
+    /// get an index, and the rows are stored as they arrive, duplicates included
+    void createTable(const QString & tableName, const QSet<QString> &columns , const QHash<QString, QString> &columnTypes = QHash<QString,QString>(), const QStringList &clusterKey = QStringList());
     void maybeAddTableColumn(const QString & table, const QString & column, const QString &columnType);
     void addTableColumn(const QString & table, const QString & column, const QString &columnType);
 
     void insertNodeData(const QString &column, const QString &columnType, const QVariantList &ids, const QVariantList &values);
-    void insertEdgeData(const QString & table, const QVariantList &froms, const QVariantList &tos, const QVariantList &values) const;
+    void insertEdgeData(const QString & table, const QVariantList &froms, const QVariantList &tos, const QVariantList &values);
+
+    /// Store edge files as (from_start, from_end, to_start, to_end, value) rows in
+    /// <table>_ranges, one row per pair of ranges on a line, with a view named
+    /// <table> that expands them back into from_node, to_node, value
+    void setStoreEdgeRanges(bool storeRanges);
+    bool storesEdgeRanges() const;
+    static QString edgeRangeTableName(const QString & table);
+    void insertEdgeRanges(const QString & table, const QVariantList &fromStarts, const QVariantList &fromEnds, const QVariantList &toStarts, const QVariantList &toEnds, const QVariantList &values);
+    void createEdgeRangeView(const QString & table);
+
+    /// Sort the rows of each (expanded) edge file by @key before inserting them,
+    /// keeping at most @memoryBytes in memory and spilling the rest to temporary files
+    void setSortEdges(bool sortEdges, ExternalEdgeSorter::SortKey key = ExternalEdgeSorter::SortByFrom, qint64 memoryBytes = 0);
+    bool sortsEdges() const;
+    ExternalEdgeSorter::SortKey edgeSortKey() const;
+    qint64 edgeSortMemory() const;
+    /// the cluster key for edge tables in the sort order
+    QStringList edgeClusterKey() const;
+
+    /// the first column of the first row of a SELECT, with ? placeholders bound to @bindValues
+    QVariant queryValue(const QString & query, const QVariantList & bindValues = QVariantList()) const;
+
+    /// a plain index; the name is made up from the table and columns
+    void createIndex(const QString & table, const QStringList & columns);
 
     void setOtypeRanges(QHash<QString, QPair<unsigned int, unsigned int> > oTypeRanges);
     QString getOTypeFromNode(unsigned int node) const;
 
-    void createOTypeTable() const;
-
-    void beginTransaction() const;
-    void commitTransaction() const;
+    void createOTypeTable();
+
+    /// insert rows into an arbitrary table; @values holds one list per column
+    void insertRows(const QString & table, const QStringList & columns, const QList<QVariantList> &values);
+
+    /// appended to every table the adapter creates or writes to; used to
+    /// load a second TF version next to the first
+    void setTableSuffix(const QString & suffix);
+    QString tableName(const QString & name) const;
+    QSet<QString> tableColumns(const QString & table) const;
+
+    void dropView(const QString & view) const;
+    void renameTable(const QString & from, const QString & to);
+
+    /// Reduce @versionTable to the rows that differ from @baseTable, with rows
+    /// lined up by @omapTable (from_node = version node, to_node = base node),
+    /// then replace it with a view of the same name that looks like the original.
+    /// Only nodes in @range are considered.
+    void deduplicateAgainstBase(const QString & versionTable, const QString & baseTable, const QString & omapTable, const QPair<unsigned int, unsigned int> & range);
+
+    /// build a full-text index over @columns of @table from the data already loaded;
+    /// @tokenizer is passed to the backend (empty for its default)
+    void createFullTextIndex(const QString & table, const QStringList & columns, const QString & tokenizer);
+
+    void beginTransaction();
+    void commitTransaction();
+
+    /// bracket the loading of the TF files; adapters that write somewhere
+    /// other than the target while loading put everything in place in finishLoading
+    virtual void beginLoading();
+    virtual void finishLoading();
+    /// called once everything has been written and committed; false if the
+    /// output could not be put in place
+    virtual bool finishImport();
+
+    /// rows per execBatch call; 0 (or never calling this) lets the adapter tune it
+    void setBatchSize(int rows);
+    /// rows per transaction; 0 (or never calling this) lets the adapter tune it
+    void setCommitSize(int rows);
+    int batchSize() const;
+    int commitSize() const;
+    /// whether tuning has stopped changing the sizes (always true if they were set)
+    bool batchSizeSettled() const;
+    bool commitSizeSettled() const;
 
     QString sqlDataType( TFFile::ValueType t ) const;
+    /// the narrowest type that holds the values described by @statistics
+    QString sqlDataType( TFFile::ValueType t, const TFFile::Statistics & statistics ) const;
 
     virtual QString integerType() const = 0;
     virtual QString stringType() const = 0;
+    /// for values that may be much longer than a feature value, such as the text of a book
+    virtual QString longTextType() const = 0;
+    /// for binary data, such as serialized bitmaps
+    virtual QString blobType() const = 0;
+    /// an integer key that the table is stored in the order of
+    virtual QString primaryKeyType() const = 0;
+    /// by default these are just integerType() and stringType()
+    virtual QString integerTypeForRange(qint64 minimum, qint64 maximum) const;
+    virtual QString stringTypeForLength(int length) const;
 
 protected:
     void performInsertNodeData(const QString &table, const QString &column, const QString &columnType, const QVariantList &ids, const QVariantList &values);
 
+    /// the starting points for tuning, which differ by backend; call from the subclass constructor
+    void setBatchDefaults(int batchSize, int commitSize);
+
+    /// prepare @queryString once and execute it over @columns (bound to @placeholders)
+    /// in batches, committing whenever the commit size is reached. Every write
+    /// to a single @table goes through here or through execStatement.
+    virtual bool execBatched(const QString &table, const QString &queryString, const QStringList &placeholders, const QList<QVariantList> &columns);
+    /// write @values of node feature @column for the nodes @ids of @table, replacing any
+    /// values already there; by default an execBatched of insertNodeDataQueryString()
+    virtual bool execNodeData(const QString &table, const QString &column, const QVariantList &ids, const QVariantList &values);
+    virtual bool execStatement(const QString &table, const QString &query);
+    /// called once createTable has made @table
+    virtual void tableCreated(const QString &table);
+    /// called once rows have been deleted from @table in bulk
+    virtual void tableShrunk(const QString &table);
+
 
     /// virtual void functions that provide the query strings
     virtual QString insertNodeDataQueryString(const QString &table, const QString &column) const = 0;
@@ -50,11 +154,37 @@ protected:
     virtual QString createTableQueryString(const QString &table, const QSet<QString> &columns, const QHash<QString, QString> & columnTypes) const = 0;
     virtual QString dropTableQueryString(const QString &table) const = 0;
     virtual QString addTableColumnQueryString(const QString &table, const QString &column, const QString &columnType) const = 0;
-    virtual QString createOTypeTableQueryString() const = 0;
+    virtual QString createOTypeTableQueryString(const QString &table) const = 0;
+    virtual QString dropViewQueryString(const QString &view) const = 0;
+    virtual QStringList createFullTextIndexQueryStrings(const QString &table, const QStringList &columns, const QString &tokenizer) const = 0;
+    /// a comparison that treats two NULLs as equal
+    virtual QString nullSafeEqualsString(const QString &left, const QString &right) const = 0;
+
+    /// run @query on the main connection; @context names the caller in warnings
+    virtual bool execQuery(const QString &query, const char *context) const;
 
     QString mConnectionName;
     QHash<QString,QSet<QString>> mTableColumns;
     QHash<QString,QPair<unsigned int,unsigned int>> mOTypeRanges;
+    QString mTableSuffix;
+    bool mStoreEdgeRanges;
+    /// the longest range stored so far, which the _seq table must cover
+    unsigned int mMaximumEdgeSpan;
+    /// rows in the _seq table, or -1 until this run has created it
+    qint64 mSeqCount;
+    bool mSortEdges;
+    ExternalEdgeSorter::SortKey mEdgeSortKey;
+    qint64 mEdgeSortMemory;
+
+private:
+    /// @nsecs is the time spent executing them, which is what the commit size is tuned on
+    void rowsWritten(int rows, qint64 nsecs);
+
+    ThroughputTuner mBatchTuner;
+    ThroughputTuner mCommitTuner;
+    bool mInTransaction;
+    qint64 mRowsSinceCommit;
+    qint64 mNsecsSinceCommit;
 };
 
 #endif // ABSTRACTDATABASEADAPTER_H
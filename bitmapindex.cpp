@@ -0,0 +1,118 @@
+#include "bitmapindex.h"
+
+#include <QtDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+
+#include <vector>
+
+#include "abstractdatabaseadapter.h"
+#include "parallel.h"
+
+namespace {
+/// past this, a feature is not really categorical and the bitmaps cost more than they save
+const int MaximumDistinctValues = 65536;
+/// the (feature, value) index has to fit MyISAM's 1000-byte keys, at 4 bytes a character in utf8mb4
+const int MaximumKeyLength = 250;
+}
+
+BitmapIndex::BitmapIndex(AbstractDatabaseAdapter *db) : mDb(db)
+{
+}
+
+QString BitmapIndex::tableName()
+{
+    return "bitmap_index";
+}
+
+void BitmapIndex::build(const QList<TFFile> &files)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    /// the columns are sized from the scan, so that the index key stays short
+    int featureLength = 1;
+    foreach( TFFile file, files ) {
+        featureLength = qMax( featureLength, file.label().length() );
+    }
+    int valueLength = 1;
+
+    QList<TFFile> categorical;
+    foreach( TFFile file, files ) {
+        if( file.fileType() != TFFile::FileTypeNode ) {
+            qWarning() << "BitmapIndex::build" << "Not a node feature:" << file.label();
+        } else if( file.statistics().distinctValues > MaximumDistinctValues ) {
+            qWarning() << "BitmapIndex::build" << "Too many distinct values for a bitmap index:" << file.label() << file.statistics().distinctValues;
+        } else if( featureLength + file.statistics().maximumStringLength > MaximumKeyLength ) {
+            qWarning() << "BitmapIndex::build" << "Values too long for a bitmap index:" << file.label() << file.statistics().maximumStringLength;
+        } else {
+            categorical << file;
+            valueLength = qMax( valueLength, file.statistics().maximumStringLength );
+        }
+    }
+
+    /// one feature per thread; QMap keeps the values in a stable order
+    std::vector<QMap<QString,RoaringBitmap>> bitmaps( static_cast<size_t>(categorical.count()) );
+    parallelFor( 0, categorical.count(), [&](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            QMap<QString,RoaringBitmap> & byValue = bitmaps[static_cast<size_t>(i)];
+            TFFile file = categorical.at(i);
+            file.readNodes( [&](unsigned int node, const QString & value) {
+                byValue[value].add(node);
+            } );
+        }
+    } );
+
+    QSet<QString> columns;
+    QHash<QString, QString> columnTypes;
+    columns << "feature" << "value" << "cardinality" << "bitmap";
+    columnTypes["feature"] = mDb->stringTypeForLength( featureLength );
+    columnTypes["value"] = mDb->stringTypeForLength( valueLength );
+    columnTypes["cardinality"] = mDb->integerType();
+    columnTypes["bitmap"] = mDb->blobType();
+    mDb->createTable( tableName(), columns, columnTypes );
+
+    QVariantList features, values, cardinalities, blobs;
+    for(int i = 0; i < categorical.count(); i++) {
+        QMapIterator<QString,RoaringBitmap> v( bitmaps.at(static_cast<size_t>(i)) );
+        while( v.hasNext() ) {
+            v.next();
+            features << categorical.at(i).label();
+            values << v.key();
+            cardinalities << static_cast<qulonglong>( v.value().cardinality() );
+            blobs << v.value().serialize();
+        }
+    }
+    mDb->insertRows( tableName(), QStringList() << "feature" << "value" << "cardinality" << "bitmap", QList<QVariantList>() << features << values << cardinalities << blobs );
+    mDb->createIndex( tableName(), QStringList() << "feature" << "value" );
+
+    qDebug() << "Built" << features.count() << "bitmaps for" << categorical.count() << "features in" << timer.elapsed() << "milliseconds";
+}
+
+RoaringBitmap BitmapIndex::lookup(const QString &feature, const QString &value) const
+{
+    const QVariant blob = mDb->queryValue( "SELECT `bitmap` FROM `" + mDb->tableName(tableName()) + "` WHERE `feature` = ? AND `value` = ?;", QVariantList() << feature << value );
+    return RoaringBitmap::deserialize( blob.toByteArray() );
+}
+
+RoaringBitmap BitmapIndex::matchAll(const QList<Condition> &conditions) const
+{
+    if( conditions.isEmpty() ) {
+        return RoaringBitmap();
+    }
+    RoaringBitmap result = lookup( conditions.first().first, conditions.first().second );
+    for(int i = 1; i < conditions.count() && !result.isEmpty(); i++) {
+        result = RoaringBitmap::intersect( result, lookup( conditions.at(i).first, conditions.at(i).second ) );
+    }
+    return result;
+}
+
+RoaringBitmap BitmapIndex::matchAny(const QList<Condition> &conditions) const
+{
+    RoaringBitmap result;
+    foreach( const Condition & condition, conditions ) {
+        result = RoaringBitmap::unite( result, lookup( condition.first, condition.second ) );
+    }
+    return result;
+}
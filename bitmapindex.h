@@ -0,0 +1,40 @@
+#ifndef BITMAPINDEX_H
+#define BITMAPINDEX_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include "roaringbitmap.h"
+#include "tffile.h"
+
+class AbstractDatabaseAdapter;
+
+/// For categorical node features (sp, vt, ps, ...), one compressed bitmap of
+/// node numbers per distinct value, kept as BLOBs in the bitmap_index table.
+/// Filters on several features then become bitmap intersections rather than
+/// table scans.
+class BitmapIndex
+{
+public:
+    typedef QPair<QString,QString> Condition;
+
+    explicit BitmapIndex(AbstractDatabaseAdapter * db);
+
+    /// build bitmaps for the values of these node files and (re)write the table
+    void build(const QList<TFFile> & files);
+
+    /// the nodes where @feature has @value
+    RoaringBitmap lookup(const QString & feature, const QString & value) const;
+    /// the nodes that satisfy every one of @conditions
+    RoaringBitmap matchAll(const QList<Condition> & conditions) const;
+    /// the nodes that satisfy any of @conditions
+    RoaringBitmap matchAny(const QList<Condition> & conditions) const;
+
+    static QString tableName();
+
+private:
+    AbstractDatabaseAdapter * mDb;
+};
+
+#endif // BITMAPINDEX_H
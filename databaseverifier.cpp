@@ -0,0 +1,172 @@
+#include "databaseverifier.h"
+
+#include <QtDebug>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QAtomicInt>
+
+#include <vector>
+
+#include "abstractdatabaseadapter.h"
+#include "parallel.h"
+#include "tffile.h"
+
+DatabaseVerifier::Checksum::Checksum() :
+    rows(0),
+    sum(0)
+{
+}
+
+bool DatabaseVerifier::Checksum::operator==(const Checksum &other) const
+{
+    return rows == other.rows && sum == other.sum;
+}
+
+bool DatabaseVerifier::Checksum::operator!=(const Checksum &other) const
+{
+    return !(*this == other);
+}
+
+DatabaseVerifier::DatabaseVerifier(const QString &folderPath, AbstractDatabaseAdapter *db) :
+    mFolder(folderPath),
+    mDb(db)
+{
+    mOTypeRanges = TFFile::readOTypeRanges( mFolder.absoluteFilePath("otype.tf") );
+}
+
+quint64 DatabaseVerifier::rowHash(const QByteArray &row)
+{
+    /// FNV-1a, then a splitmix64 finish so that sums of similar rows don't collide
+    quint64 hash = 14695981039346656037ULL;
+    for(int i = 0; i < row.size(); i++) {
+        hash ^= static_cast<unsigned char>(row.at(i));
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+bool DatabaseVerifier::verify()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<TFFile> files;
+    foreach( QFileInfo info, mFolder.entryInfoList(QStringList("*.tf"), QDir::Files) ) {
+        if( info.fileName() == "otype.tf" || info.fileName() == "otext.tf" || info.fileName().startsWith("omap@") ) {
+            continue;
+        }
+        TFFile file(info);
+        if( file.fileType() != TFFile::FileTypeConfig ) {
+            files << file;
+        }
+    }
+
+    /// each thread reads with its own connection, since one can't be shared between threads
+    std::vector<Checksum> fromFiles( static_cast<size_t>(files.count()) );
+    std::vector<Checksum> fromDatabase( static_cast<size_t>(files.count()) );
+    QAtomicInt nextConnection(0);
+    parallelFor( 0, files.count(), [&](int begin, int end) {
+        const QString name = "verify" + QString::number( nextConnection.fetchAndAddOrdered(1) );
+        {
+            QSqlDatabase db = mDb->cloneConnection(name);
+            for(int i = begin; i < end; i++) {
+                const bool isEdge = files.at(i).fileType() == TFFile::FileTypeEdge;
+                fromFiles[static_cast<size_t>(i)] = fileChecksum( files.at(i).label(), isEdge );
+                fromDatabase[static_cast<size_t>(i)] = databaseChecksum( db, files.at(i).label(), isEdge, files.at(i).valueType() == TFFile::ValueTypeInteger );
+            }
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+    } );
+
+    int mismatches = 0;
+    for(int i = 0; i < files.count(); i++) {
+        const Checksum & tf = fromFiles[static_cast<size_t>(i)];
+        const Checksum & sql = fromDatabase[static_cast<size_t>(i)];
+        if( tf != sql ) {
+            mismatches++;
+            qWarning().noquote() << "Differs:" << files.at(i).label() << "-" << tf.rows << "rows in the TF file," << sql.rows << "in the database";
+        } else {
+            qDebug().noquote() << "Matches:" << files.at(i).label() << "-" << tf.rows << "rows";
+        }
+    }
+
+    qInfo() << "Verified" << files.count() << "features," << mismatches << "differ, in" << timer.elapsed() << "milliseconds";
+    return mismatches == 0;
+}
+
+DatabaseVerifier::Checksum DatabaseVerifier::fileChecksum(const QString &feature, bool isEdge) const
+{
+    Checksum checksum;
+    TFFile file( QFileInfo( mFolder.absoluteFilePath(feature + ".tf") ) );
+    const bool isInteger = file.valueType() == TFFile::ValueTypeInteger;
+    if( isEdge ) {
+        file.readEdges( [&](unsigned int from, unsigned int to, const QString & value) {
+            checksum.sum += rowHash( QByteArray::number(from) + '\t' + QByteArray::number(to) + '\t' + value.toUtf8() );
+            checksum.rows++;
+        } );
+    } else {
+        file.readNodes( [&](unsigned int node, const QString & value) {
+            /// an integer column has nowhere to keep an empty value
+            if( isInteger && value.isEmpty() ) {
+                return;
+            }
+            checksum.sum += rowHash( QByteArray::number(node) + '\t' + value.toUtf8() );
+            checksum.rows++;
+        } );
+    }
+    return checksum;
+}
+
+DatabaseVerifier::Checksum DatabaseVerifier::databaseChecksum(QSqlDatabase db, const QString &feature, bool isEdge, bool isInteger) const
+{
+    Checksum checksum;
+    const QStringList tables = db.tables(QSql::AllTables);
+
+    QStringList queries;
+    if( isEdge ) {
+        if( tables.contains(feature) ) {
+            queries << "SELECT `from_node`, `to_node`, `value` FROM `" + feature + "`;";
+        }
+    } else {
+        /// a node feature is a column in the table of each otype that has it
+        foreach( QString otype, mOTypeRanges.keys() ) {
+            if( tables.contains(otype) && db.record(otype).contains(feature) ) {
+                queries << "SELECT `_id`, `" + feature + "` FROM `" + otype + "` WHERE `" + feature + "` IS NOT NULL;";
+            }
+        }
+    }
+    if( queries.isEmpty() ) {
+        qWarning() << "DatabaseVerifier::databaseChecksum" << "Not in the database:" << feature;
+    }
+
+    foreach( QString query, queries ) {
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        if( !q.exec(query) ) {
+            qWarning() << "DatabaseVerifier::databaseChecksum" << q.lastError().text() << query;
+            continue;
+        }
+        const int columnCount = q.record().count();
+        while( q.next() ) {
+            if( !isEdge && isInteger && q.value(1).toString().isEmpty() ) {
+                continue;
+            }
+            QByteArray row = q.value(0).toString().toUtf8();
+            for(int c = 1; c < columnCount; c++) {
+                row += '\t' + q.value(c).toString().toUtf8();
+            }
+            checksum.sum += rowHash(row);
+            checksum.rows++;
+        }
+    }
+    return checksum;
+}
@@ -0,0 +1,44 @@
+#ifndef DATABASEVERIFIER_H
+#define DATABASEVERIFIER_H
+
+#include <QDir>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+
+class AbstractDatabaseAdapter;
+class QSqlDatabase;
+
+/// Checks a database against the TF folder it was made from, without
+/// importing anything. For every feature, both sides are reduced to a count
+/// and an order-independent checksum (the sum of a hash of each row), so
+/// neither needs sorting or more than one row in memory at a time.
+class DatabaseVerifier
+{
+public:
+    struct Checksum {
+        Checksum();
+        qint64 rows;
+        quint64 sum;
+        bool operator==(const Checksum & other) const;
+        bool operator!=(const Checksum & other) const;
+    };
+
+    DatabaseVerifier(const QString & folderPath, AbstractDatabaseAdapter * db);
+
+    /// compare every node and edge feature, several at a time; true if they all match
+    bool verify();
+
+    /// a row is its node numbers and value, tab-separated, as UTF-8
+    static quint64 rowHash(const QByteArray & row);
+
+private:
+    Checksum fileChecksum(const QString & feature, bool isEdge) const;
+    Checksum databaseChecksum(QSqlDatabase db, const QString & feature, bool isEdge, bool isInteger) const;
+
+    QDir mFolder;
+    AbstractDatabaseAdapter * mDb;
+    QHash<QString,QPair<unsigned int,unsigned int>> mOTypeRanges;
+};
+
+#endif // DATABASEVERIFIER_H
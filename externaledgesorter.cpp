@@ -0,0 +1,164 @@
+#include "externaledgesorter.h"
+
+#include <QtDebug>
+#include <QDataStream>
+
+#include <algorithm>
+#include <queue>
+
+ExternalEdgeSorter::ExternalEdgeSorter(SortKey key, qint64 memoryBytes) :
+    mKey(key),
+    mMemoryBytes(memoryBytes),
+    mBufferBytes(0)
+{
+}
+
+ExternalEdgeSorter::~ExternalEdgeSorter()
+{
+}
+
+int ExternalEdgeSorter::runCount() const
+{
+    return static_cast<int>(mRuns.size());
+}
+
+int ExternalEdgeSorter::compareValues(const QVariant &a, const QVariant &b)
+{
+    auto rank = [](const QVariant & v) {
+        if( v.isNull() ) {
+            return 0;
+        }
+        return v.type() == QVariant::LongLong ? 1 : 2;
+    };
+    const int aRank = rank(a);
+    const int bRank = rank(b);
+    if( aRank != bRank || aRank == 0 ) {
+        return aRank - bRank;
+    }
+    if( aRank == 1 ) {
+        const qlonglong x = a.toLongLong();
+        const qlonglong y = b.toLongLong();
+        return x < y ? -1 : ( x > y ? 1 : 0 );
+    }
+    return QString::compare( a.toString(), b.toString() );
+}
+
+bool ExternalEdgeSorter::lessThan(const Edge &a, const Edge &b) const
+{
+    const quint32 aFirst = mKey == SortByFrom ? a.from : a.to;
+    const quint32 bFirst = mKey == SortByFrom ? b.from : b.to;
+    if( aFirst != bFirst ) {
+        return aFirst < bFirst;
+    }
+    const quint32 aSecond = mKey == SortByFrom ? a.to : a.from;
+    const quint32 bSecond = mKey == SortByFrom ? b.to : b.from;
+    if( aSecond != bSecond ) {
+        return aSecond < bSecond;
+    }
+    return compareValues(a.value, b.value) < 0;
+}
+
+void ExternalEdgeSorter::add(unsigned int from, unsigned int to, const QVariant &value)
+{
+    Edge edge;
+    edge.from = from;
+    edge.to = to;
+    edge.value = value;
+    mBuffer.push_back(edge);
+
+    /// a rough count: the struct plus the characters of a string value
+    mBufferBytes += static_cast<qint64>(sizeof(Edge));
+    if( value.type() == QVariant::String ) {
+        mBufferBytes += value.toString().size() * 2;
+    }
+    if( mBufferBytes >= mMemoryBytes ) {
+        spill();
+    }
+}
+
+void ExternalEdgeSorter::spill()
+{
+    std::sort( mBuffer.begin(), mBuffer.end(), [this](const Edge & a, const Edge & b) { return lessThan(a, b); } );
+
+    std::unique_ptr<QTemporaryFile> run( new QTemporaryFile );
+    if( !run->open() ) {
+        qCritical() << "ExternalEdgeSorter::spill" << "Could not create a temporary file.";
+        return;
+    }
+    QDataStream out(run.get());
+    for(const Edge & edge : mBuffer) {
+        out << edge.from << edge.to << edge.value;
+    }
+    run->flush();
+    mRuns.push_back( std::move(run) );
+
+    mBuffer.clear();
+    mBuffer.shrink_to_fit();
+    mBufferBytes = 0;
+}
+
+void ExternalEdgeSorter::finish(const Sink &sink, int batchRows)
+{
+    QVariantList froms, tos, values;
+    auto emitEdge = [&](const Edge & edge) {
+        froms << edge.from;
+        tos << edge.to;
+        values << edge.value;
+        if( froms.count() >= batchRows ) {
+            sink(froms, tos, values);
+            froms.clear();
+            tos.clear();
+            values.clear();
+        }
+    };
+
+    if( mRuns.empty() ) {
+        /// everything fit in memory
+        std::sort( mBuffer.begin(), mBuffer.end(), [this](const Edge & a, const Edge & b) { return lessThan(a, b); } );
+        for(const Edge & edge : mBuffer) {
+            emitEdge(edge);
+        }
+    } else {
+        if( !mBuffer.empty() ) {
+            spill();
+        }
+
+        /// k-way merge, with the smallest current edge of each run in a heap
+        std::vector<std::unique_ptr<QDataStream>> streams;
+        std::vector<Edge> heads( mRuns.size() );
+        auto greater = [&](size_t a, size_t b) { return lessThan(heads[b], heads[a]); };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+
+        auto readNext = [&](size_t run) {
+            QDataStream & in = *streams[run];
+            if( in.atEnd() ) {
+                return false;
+            }
+            in >> heads[run].from >> heads[run].to >> heads[run].value;
+            return in.status() == QDataStream::Ok;
+        };
+
+        for(size_t run = 0; run < mRuns.size(); run++) {
+            mRuns[run]->seek(0);
+            streams.emplace_back( new QDataStream( mRuns[run].get() ) );
+            if( readNext(run) ) {
+                heap.push(run);
+            }
+        }
+        while( !heap.empty() ) {
+            const size_t run = heap.top();
+            heap.pop();
+            emitEdge( heads[run] );
+            if( readNext(run) ) {
+                heap.push(run);
+            }
+        }
+    }
+
+    if( !froms.isEmpty() ) {
+        sink(froms, tos, values);
+    }
+
+    mBuffer.clear();
+    mRuns.clear();
+}
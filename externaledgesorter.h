@@ -0,0 +1,54 @@
+#ifndef EXTERNALEDGESORTER_H
+#define EXTERNALEDGESORTER_H
+
+#include <QVariant>
+#include <QVariantList>
+#include <QList>
+#include <QTemporaryFile>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// Sorts the edges of one file in bounded memory: edges are collected until
+/// the budget is used up, sorted, and spilled to a temporary file as a run;
+/// finish() then merges the runs. Every edge added comes out, duplicates included.
+class ExternalEdgeSorter
+{
+public:
+    enum SortKey { SortByFrom, SortByTo };
+
+    /// called with consecutive sorted slices of the output
+    typedef std::function<void(const QVariantList & froms, const QVariantList & tos, const QVariantList & values)> Sink;
+
+    ExternalEdgeSorter(SortKey key, qint64 memoryBytes);
+    ~ExternalEdgeSorter();
+
+    /// @value is passed on as it is, so a null value stays NULL and an integer stays a number
+    void add(unsigned int from, unsigned int to, const QVariant & value);
+
+    /// send everything to @sink in order, @batchRows rows at a time
+    void finish(const Sink & sink, int batchRows);
+
+    int runCount() const;
+
+private:
+    struct Edge {
+        quint32 from;
+        quint32 to;
+        QVariant value;
+    };
+
+    /// nulls, then integers, then strings
+    static int compareValues(const QVariant & a, const QVariant & b);
+    bool lessThan(const Edge & a, const Edge & b) const;
+    void spill();
+
+    SortKey mKey;
+    qint64 mMemoryBytes;
+    qint64 mBufferBytes;
+    std::vector<Edge> mBuffer;
+    std::vector<std::unique_ptr<QTemporaryFile>> mRuns;
+};
+
+#endif // EXTERNALEDGESORTER_H
@@ -4,10 +4,20 @@
 #include <QStringList>
 #include <QMap>
 #include <QCommandLineParser>
+#include <QDir>
 
 #include "reader.h"
 #include "mysqldatabaseadapter.h"
 #include "sqlitedatabaseadapter.h"
+#include "mysqldumpadapter.h"
+#include "databaseverifier.h"
+#include "tfparser.h"
+
+/// the comma-separated values of @option, without empty entries
+static QStringList listValue(const QCommandLineParser & parser, const QCommandLineOption & option)
+{
+    return parser.value(option).split(",", Qt::SkipEmptyParts);
+}
 
 int main(int argc, char *argv[])
 {
@@ -20,15 +30,89 @@ int main(int argc, char *argv[])
     parser.addHelpOption();
     parser.addVersionOption();
     parser.addPositionalArgument("path-to-data", QCoreApplication::translate("main", "Path to folder containing .tf files (e.g., otype.tf)."));
-    parser.addPositionalArgument("which-sql", QCoreApplication::translate("main", "sqlite | mysql"));
+    parser.addPositionalArgument("which-sql", QCoreApplication::translate("main", "sqlite | mysql | mysqldump"));
     parser.addPositionalArgument("connection-string", QCoreApplication::translate("main", "For sqlite, a filename, for MySQL, a string like this: hostname=myhost;databasename=mydatabase;username=myuser;password=mypassword"));
 
+    QCommandLineOption batchSizeOption("batch-size", QCoreApplication::translate("main", "Rows per insert batch (default: tuned automatically while importing)."), "rows", "0");
+    parser.addOption(batchSizeOption);
+    QCommandLineOption commitSizeOption("commit-size", QCoreApplication::translate("main", "Rows per transaction (default: tuned automatically while importing)."), "rows", "0");
+    parser.addOption(commitSizeOption);
+
+    QCommandLineOption versionsOption("versions", QCoreApplication::translate("main", "Comma-separated further TF versions (sibling folders of path-to-data) to load as differences from it, using its omap@<version>-<base>.tf files."), "versions");
+    parser.addOption(versionsOption);
+
+    QCommandLineOption shardsOption("sqlite-shards", QCoreApplication::translate("main", "SQLite only: write each table into its own temporary file from its own thread, then merge them into the target."));
+    parser.addOption(shardsOption);
+
+    QCommandLineOption fullTextOption("fulltext", QCoreApplication::translate("main", "Comma-separated string features to build full-text indexes for (e.g., g_word_utf8,lex,gloss)."), "features");
+    parser.addOption(fullTextOption);
+    QCommandLineOption tokenizerOption("fulltext-tokenizer", QCoreApplication::translate("main", "For sqlite, an FTS5 tokenize string (default: unicode61 remove_diacritics 0); for MySQL, a full-text parser such as ngram."), "tokenizer");
+    parser.addOption(tokenizerOption);
+
+    QCommandLineOption otextOption("otext-types", QCoreApplication::translate("main", "Comma-separated otypes (e.g., book,chapter,verse,sentence,clause) whose text is rendered in each otext.tf format into otext_<format> tables."), "otypes");
+    parser.addOption(otextOption);
+
+    QCommandLineOption inMemoryOption("sqlite-in-memory", QCoreApplication::translate("main", "SQLite only: build the database in memory and write the file in one pass at the end."));
+    parser.addOption(inMemoryOption);
+    QCommandLineOption pageSizeOption("sqlite-page-size", QCoreApplication::translate("main", "SQLite only: page size of the output file, in bytes."), "bytes", "0");
+    parser.addOption(pageSizeOption);
+    QCommandLineOption autoVacuumOption("sqlite-auto-vacuum", QCoreApplication::translate("main", "SQLite only: auto-vacuum mode of the output file (none, full or incremental)."), "mode");
+    parser.addOption(autoVacuumOption);
+
+    QCommandLineOption edgeRangesOption("edge-ranges", QCoreApplication::translate("main", "Store edges as ranges in <edge>_ranges tables, with an <edge> view that expands them."));
+    parser.addOption(edgeRangesOption);
+
+    QCommandLineOption bitmapOption("bitmap-features", QCoreApplication::translate("main", "Comma-separated categorical node features (e.g., sp,vt,ps) to build compressed bitmap indexes for, in the bitmap_index table."), "features");
+    parser.addOption(bitmapOption);
+
+    QCommandLineOption sortEdgesOption("sort-edges", QCoreApplication::translate("main", "Sort the rows of each edge table by from (from_node, to_node) or to (to_node, from_node) before inserting them, and store the table in that order."), "from|to");
+    parser.addOption(sortEdgesOption);
+    QCommandLineOption sortMemoryOption("sort-memory", QCoreApplication::translate("main", "Memory to sort edges in before spilling to temporary files, in megabytes (default: 512)."), "megabytes", "512");
+    parser.addOption(sortMemoryOption);
+
+    QCommandLineOption nodesOption("nodes", QCoreApplication::translate("main", "Import only these nodes, as a TF node range (e.g., 1-28763,426585-426623). Not allowed with --versions, whose node numbers differ."), "ranges");
+    parser.addOption(nodesOption);
+    QCommandLineOption booksOption("books", QCoreApplication::translate("main", "Import only the nodes with slots in these books (comma-separated values of book.tf, e.g., Genesis,Exodus)."), "books");
+    parser.addOption(booksOption);
+    QCommandLineOption otypesOption("otypes", QCoreApplication::translate("main", "Import only these otypes (comma-separated, e.g., word,clause)."), "otypes");
+    parser.addOption(otypesOption);
+    QCommandLineOption featuresOption("features", QCoreApplication::translate("main", "Import only these features (comma-separated .tf file names without the extension, e.g., oslots,g_word_utf8,sp)."), "features");
+    parser.addOption(featuresOption);
+
+    QCommandLineOption dumpThreadsOption("dump-threads", QCoreApplication::translate("main", "mysqldump only: threads compressing the output (default: one per core)."), "threads", "0");
+    parser.addOption(dumpThreadsOption);
+
+    QCommandLineOption wordContextOption("word-context", QCoreApplication::translate("main", "Build a word_context table with the containing node of every slot at each level of --word-context-levels."));
+    parser.addOption(wordContextOption);
+    QCommandLineOption contextLevelsOption("word-context-levels", QCoreApplication::translate("main", "Comma-separated otypes for --word-context (default: phrase,clause,sentence,verse,chapter,book)."), "otypes", "phrase,clause,sentence,verse,chapter,book");
+    parser.addOption(contextLevelsOption);
+
+    QCommandLineOption verifyOption("verify", QCoreApplication::translate("main", "Import nothing; instead compare the existing database with the TF files, feature by feature, and report the ones that differ."));
+    parser.addOption(verifyOption);
+
+    QCommandLineOption engineOption("mysql-engine", QCoreApplication::translate("main", "MySQL and mysqldump: storage engine for the tables (e.g., InnoDB, or MyISAM for a read-only release)."), "engine");
+    parser.addOption(engineOption);
+    QCommandLineOption rowFormatOption("mysql-row-format", QCoreApplication::translate("main", "MySQL and mysqldump: row format for the tables (e.g., COMPRESSED, DYNAMIC)."), "format");
+    parser.addOption(rowFormatOption);
+
+    QCommandLineOption benchmarkParseOption("benchmark-parse", QCoreApplication::translate("main", "Import nothing; instead time the parsing of every .tf file in path-to-data with its specialized parser and with the general one (which-sql and connection-string may be left out)."));
+    parser.addOption(benchmarkParseOption);
+
     parser.process(a);
     const QStringList args = parser.positionalArguments();
+    if( parser.isSet(benchmarkParseOption) && !args.isEmpty() ) {
+        TFParser::benchmark( args.at(0) );
+        return 0;
+    }
     if( args.count() < 3 )
     {
         parser.showHelp();
     }
+    if( parser.isSet(nodesOption) && !listValue(parser, versionsOption).isEmpty() ) {
+        /// node numbers differ from version to version
+        qCritical() << "--nodes cannot be combined with --versions; select by --books or --otypes instead.";
+        return -1;
+    }
     const QString dataPath = args.at(0);
     const QString whichSql = args.at(1);
     const QString connectionString = args.at(2);
@@ -37,7 +121,10 @@ int main(int argc, char *argv[])
 
     if( whichSql == "sqlite" )
     {
-        db = new SqliteDatabaseAdapter(connectionString);
+        /// an in-memory database would be empty, which is no use for verifying
+        SqliteDatabaseAdapter * sqlite = new SqliteDatabaseAdapter(connectionString, parser.isSet(inMemoryOption) && !parser.isSet(verifyOption), parser.value(pageSizeOption).toInt(), parser.value(autoVacuumOption));
+        sqlite->setUseShards( parser.isSet(shardsOption) );
+        db = sqlite;
     }
     else if ( whichSql == "mysql" )
     {
@@ -52,7 +139,15 @@ int main(int argc, char *argv[])
         const QString databasename = params.value("databasename");
         const QString username = params.value("username");
         const QString password = params.value("password");
-        db = new MySqlDatabaseAdapter(hostname, databasename, username, password);
+        MySqlDatabaseAdapter * mysql = new MySqlDatabaseAdapter(hostname, databasename, username, password);
+        mysql->setTableOptions( parser.value(engineOption), parser.value(rowFormatOption) );
+        db = mysql;
+    }
+    else if ( whichSql == "mysqldump" )
+    {
+        MySqlDumpAdapter * dump = new MySqlDumpAdapter(connectionString, parser.value(dumpThreadsOption).toInt());
+        dump->setTableOptions( parser.value(engineOption), parser.value(rowFormatOption) );
+        db = dump;
     }
     else
     {
@@ -69,10 +164,54 @@ int main(int argc, char *argv[])
         qInfo() << "Database opened.";
     }
 
+    if( parser.isSet(verifyOption) ) {
+        const bool matches = DatabaseVerifier( dataPath, db ).verify();
+        delete db;
+        return matches ? 0 : 1;
+    }
+
+    db->setBatchSize( parser.value(batchSizeOption).toInt() );
+    db->setCommitSize( parser.value(commitSizeOption).toInt() );
+    db->setStoreEdgeRanges( parser.isSet(edgeRangesOption) );
+    if( parser.isSet(sortEdgesOption) ) {
+        const QString sortEdges = parser.value(sortEdgesOption);
+        if( sortEdges != "from" && sortEdges != "to" ) {
+            parser.showHelp();
+        }
+        if( parser.isSet(edgeRangesOption) ) {
+            qWarning() << "--sort-edges has no effect with --edge-ranges.";
+        }
+        db->setSortEdges( true, sortEdges == "to" ? ExternalEdgeSorter::SortByTo : ExternalEdgeSorter::SortByFrom, parser.value(sortMemoryOption).toLongLong() * 1024 * 1024 );
+    }
+
     Reader r(dataPath, db);
+    r.setNodeRanges( parser.value(nodesOption) );
+    r.setBooks( listValue(parser, booksOption) );
+    r.setOtypes( listValue(parser, otypesOption) );
+    r.setFeatures( listValue(parser, featuresOption) );
+    if( parser.isSet(wordContextOption) ) {
+        r.setContextLevels( listValue(parser, contextLevelsOption) );
+    }
+    r.setBitmapFeatures( listValue(parser, bitmapOption) );
+    r.setOTextTypes( listValue(parser, otextOption) );
+    r.setFullTextFeatures( listValue(parser, fullTextOption), parser.value(tokenizerOption) );
     r.loadData();
 
+    const QStringList versions = listValue(parser, versionsOption);
+    foreach( QString version, versions ) {
+        QDir versionFolder( dataPath );
+        versionFolder.cdUp();
+        Reader v( versionFolder.absoluteFilePath(version), db );
+        v.setBaseVersion( dataPath );
+        v.setBooks( listValue(parser, booksOption) );
+        v.setOtypes( listValue(parser, otypesOption) );
+        v.setFeatures( listValue(parser, featuresOption) );
+        v.loadData();
+    }
+
+    const bool finished = db->finishImport();
+
     delete db;
 
-    return 0;
+    return finished ? 0 : -1;
 }
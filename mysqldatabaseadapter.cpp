@@ -4,6 +4,9 @@
 
 MySqlDatabaseAdapter::MySqlDatabaseAdapter(const QString &hostname, const QString &databasename, const QString &username, const QString &password) : AbstractDatabaseAdapter(hostname+databasename)
 {
+    /// keep transactions modest so that InnoDB's undo log stays small
+    setBatchDefaults(2000, 50000);
+
     QSqlDatabase db = QSqlDatabase::addDatabase("QMYSQL", mConnectionName);
     db.setHostName(hostname);
     db.setDatabaseName(databasename);
@@ -15,15 +18,99 @@ MySqlDatabaseAdapter::MySqlDatabaseAdapter(const QString &hostname, const QStrin
         return;
     }
 
+    /// before AUTOCOMMIT=0, since sql_log_bin can't be changed inside a transaction
+    applyBulkLoadProfile();
+
     QSqlQuery q(QSqlDatabase::database(mConnectionName));
     if( ! q.exec("SET AUTOCOMMIT=0;")  ) {
         qWarning() << "MySqlDatabaseAdapter::MySqlDatabaseAdapter" << q.lastError().text() << q.lastQuery();
     }
 }
 
+MySqlDatabaseAdapter::MySqlDatabaseAdapter(const QString &connectionName) : AbstractDatabaseAdapter(connectionName)
+{
+    setBatchDefaults(2000, 50000);
+}
+
 MySqlDatabaseAdapter::~MySqlDatabaseAdapter()
 {
+    /// if the import stopped early, the session still shouldn't be left this way
+    restoreSession();
+}
 
+void MySqlDatabaseAdapter::applyBulkLoadProfile()
+{
+    QSqlDatabase db = QSqlDatabase::database(mConnectionName);
+    foreach( QString variable, QStringList() << "unique_checks" << "foreign_key_checks" << "sql_log_bin" ) {
+        const QVariant old = queryValue( "SELECT @@SESSION." + variable + ";" );
+        if( !old.isValid() ) {
+            continue;
+        }
+        QSqlQuery q(db);
+        if( q.exec( "SET SESSION " + variable + " = 0;" ) ) {
+            mSavedSession.insert( variable, old );
+        } else if( variable == "sql_log_bin" ) {
+            /// needs SUPER or SYSTEM_VARIABLES_ADMIN
+            qWarning() << "Not permitted to turn off binary logging for this session; the import will be logged.";
+        } else {
+            qWarning() << "MySqlDatabaseAdapter::applyBulkLoadProfile" << q.lastError().text() << q.lastQuery();
+        }
+    }
+}
+
+void MySqlDatabaseAdapter::restoreSession()
+{
+    if( mSavedSession.isEmpty() ) {
+        return;
+    }
+    /// with AUTOCOMMIT=0 a transaction is always open, and MySQL won't change sql_log_bin inside one
+    execQuery( "COMMIT;", "MySqlDatabaseAdapter::restoreSession" );
+    QMutableHashIterator<QString,QVariant> i( mSavedSession );
+    while( i.hasNext() ) {
+        i.next();
+        /// anything that fails is kept, to be tried again from the destructor
+        if( execQuery( "SET SESSION " + i.key() + " = " + QString::number( i.value().toInt() ) + ";", "MySqlDatabaseAdapter::restoreSession" ) ) {
+            i.remove();
+        }
+    }
+}
+
+void MySqlDatabaseAdapter::setTableOptions(const QString &engine, const QString &rowFormat)
+{
+    mEngine = engine;
+    mRowFormat = rowFormat;
+}
+
+bool MySqlDatabaseAdapter::isMyISAM() const
+{
+    return mEngine.compare("MyISAM", Qt::CaseInsensitive) == 0;
+}
+
+void MySqlDatabaseAdapter::tableCreated(const QString &table)
+{
+    /// MyISAM can put off its non-unique indexes and build them in one pass
+    if( isMyISAM() && execStatement( table, "ALTER TABLE `" + table + "` DISABLE KEYS;" ) ) {
+        mKeysDisabled << table;
+    }
+}
+
+void MySqlDatabaseAdapter::finishLoading()
+{
+    QElapsedTimer timer;
+    timer.start();
+    foreach( QString table, mKeysDisabled ) {
+        execStatement( table, "ALTER TABLE `" + table + "` ENABLE KEYS;" );
+    }
+    if( !mKeysDisabled.isEmpty() ) {
+        qDebug() << "Rebuilt the indexes of" << mKeysDisabled.count() << "tables in" << timer.elapsed() << "milliseconds";
+    }
+    mKeysDisabled.clear();
+}
+
+bool MySqlDatabaseAdapter::finishImport()
+{
+    restoreSession();
+    return true;
 }
 
 QString MySqlDatabaseAdapter::insertNodeDataQueryString(const QString &table, const QString &column) const
@@ -47,7 +134,14 @@ QString MySqlDatabaseAdapter::createTableQueryString(const QString &table, const
             query += ", ";
         }
     }
-    query += ");";
+    query += ")";
+    if( !mEngine.isEmpty() ) {
+        query += " ENGINE=" + mEngine;
+    }
+    if( !mRowFormat.isEmpty() ) {
+        query += " ROW_FORMAT=" + mRowFormat.toUpper();
+    }
+    query += ";";
     return query;
 }
 
@@ -61,9 +155,33 @@ QString MySqlDatabaseAdapter::addTableColumnQueryString(const QString &table, co
     return "ALTER TABLE `" + table + "` ADD `" + column + "` "+columnType+";";
 }
 
-QString MySqlDatabaseAdapter::createOTypeTableQueryString() const
+QString MySqlDatabaseAdapter::createOTypeTableQueryString(const QString &table) const
+{
+    return "INSERT INTO `"+table+"` (`startNode`, `endNode`, `typeLabel`) VALUES (:startNode,:endNode,:typeLabel);";
+}
+
+QString MySqlDatabaseAdapter::dropViewQueryString(const QString &view) const
+{
+    return "DROP VIEW IF EXISTS `" + view + "`;";
+}
+
+QString MySqlDatabaseAdapter::nullSafeEqualsString(const QString &left, const QString &right) const
+{
+    return left + " <=> " + right;
+}
+
+QStringList MySqlDatabaseAdapter::createFullTextIndexQueryStrings(const QString &table, const QStringList &columns, const QString &tokenizer) const
 {
-    return "INSERT INTO otype (`startNode`, `endNode`, `typeLabel`) VALUES (:startNode,:endNode,:typeLabel);";
+    /// for MySQL the tokenizer is a full-text parser plugin, such as ngram
+    QStringList quoted;
+    foreach( QString column, columns ) {
+        quoted << "`" + column + "`";
+    }
+    QString query = "ALTER TABLE `" + table + "` ADD FULLTEXT INDEX `" + table + "_fts` (" + quoted.join(",") + ")";
+    if( !tokenizer.isEmpty() ) {
+        query += " WITH PARSER " + tokenizer;
+    }
+    return QStringList() << query + ";";
 }
 
 QString MySqlDatabaseAdapter::integerType() const
@@ -76,6 +194,45 @@ QString MySqlDatabaseAdapter::stringType() const
     return "VARCHAR(255)";
 }
 
+QString MySqlDatabaseAdapter::longTextType() const
+{
+    return "LONGTEXT";
+}
+
+QString MySqlDatabaseAdapter::blobType() const
+{
+    return "LONGBLOB";
+}
+
+QString MySqlDatabaseAdapter::primaryKeyType() const
+{
+    /// InnoDB clusters every table on its primary key
+    return "INT PRIMARY KEY";
+}
+
+QString MySqlDatabaseAdapter::integerTypeForRange(qint64 minimum, qint64 maximum) const
+{
+    if( minimum >= -128 && maximum <= 127 ) {
+        return "TINYINT";
+    } else if( minimum >= -32768 && maximum <= 32767 ) {
+        return "SMALLINT";
+    } else if( minimum >= -8388608 && maximum <= 8388607 ) {
+        return "MEDIUMINT";
+    } else if( minimum >= -2147483648LL && maximum <= 2147483647LL ) {
+        return "INT";
+    }
+    return "BIGINT";
+}
+
+QString MySqlDatabaseAdapter::stringTypeForLength(int length) const
+{
+    /// longer VARCHARs would eat into the 64KB row limit of wide tables like word
+    if( length > 255 ) {
+        return "TEXT";
+    }
+    return "VARCHAR(" + QString::number( qMax(1, length) ) + ")";
+}
+
 QMap<QString, QString> MySqlDatabaseAdapter::parseConnectionString(const QString &connectionString)
 {
     QMap<QString, QString> params;
@@ -9,17 +9,54 @@ public:
     explicit MySqlDatabaseAdapter(const QString &hostname, const QString &databasename, const QString &username, const QString &password);
     ~MySqlDatabaseAdapter() override;
 
+    /// ENGINE and ROW_FORMAT for every table created from here on (e.g., InnoDB
+    /// and COMPRESSED, or MyISAM for a read-only release); empty for the server default
+    void setTableOptions(const QString & engine, const QString & rowFormat);
+
+    void finishLoading() override;
+    /// puts the session variables back as they were
+    bool finishImport() override;
+
     QString insertNodeDataQueryString(const QString &table, const QString &column) const override;
     QString insertEdgeDataQueryString(const QString &table) const override;
     QString createTableQueryString(const QString &table, const QSet<QString> &columns, const QHash<QString, QString> &columnTypes) const override;
     QString dropTableQueryString(const QString &table) const override;
     QString addTableColumnQueryString(const QString &table, const QString &column, const QString &columnType) const override;
-    QString createOTypeTableQueryString() const override;
+    QString createOTypeTableQueryString(const QString &table) const override;
+    QString dropViewQueryString(const QString &view) const override;
+    QString nullSafeEqualsString(const QString &left, const QString &right) const override;
+    QStringList createFullTextIndexQueryStrings(const QString &table, const QStringList &columns, const QString &tokenizer) const override;
 
     QString integerType() const override;
     QString stringType() const override;
+    QString longTextType() const override;
+    QString blobType() const override;
+    QString primaryKeyType() const override;
+    QString integerTypeForRange(qint64 minimum, qint64 maximum) const override;
+    QString stringTypeForLength(int length) const override;
 
     static QMap<QString, QString> parseConnectionString(const QString& connectionString);
+
+protected:
+    /// for subclasses that only need the MySQL dialect, without a connection
+    explicit MySqlDatabaseAdapter(const QString &connectionName);
+
+    void tableCreated(const QString &table) override;
+
+    bool isMyISAM() const;
+
+private:
+    /// the MySQL counterpart of SqliteDatabaseAdapter::configureConnection: turn
+    /// off per-row checks and binary logging for this session, remembering the old values
+    void applyBulkLoadProfile();
+    void restoreSession();
+
+    QString mEngine;
+    QString mRowFormat;
+    /// session variable -> value before applyBulkLoadProfile
+    QHash<QString,QVariant> mSavedSession;
+    /// MyISAM tables whose non-unique indexes are rebuilt in finishLoading
+    QStringList mKeysDisabled;
 };
 
 #endif // MYSQLDATABASEADAPTER_H
@@ -0,0 +1,183 @@
+#include "mysqldumpadapter.h"
+
+#include <QtDebug>
+#include <QRegExp>
+#include <QElapsedTimer>
+
+#include "parallelgzipwriter.h"
+
+namespace {
+/// mysqldump's default net_buffer_length; well inside any max_allowed_packet
+const int StatementBytes = 1024 * 1024;
+}
+
+MySqlDumpAdapter::MySqlDumpAdapter(const QString &filename, int threads) : MySqlDatabaseAdapter(filename),
+    mOutput( new ParallelGzipWriter(filename, threads) ),
+    mFinished(false)
+{
+    mOutput->write( "-- Written by textfabric2sql\n"
+                    "/*!40101 SET NAMES utf8mb4 */;\n"
+                    "/*!40014 SET @OLD_UNIQUE_CHECKS=@@UNIQUE_CHECKS, UNIQUE_CHECKS=0 */;\n"
+                    "/*!40014 SET @OLD_FOREIGN_KEY_CHECKS=@@FOREIGN_KEY_CHECKS, FOREIGN_KEY_CHECKS=0 */;\n"
+                    "/*!40101 SET @OLD_SQL_MODE=@@SQL_MODE, SQL_MODE='NO_AUTO_VALUE_ON_ZERO' */;\n\n" );
+}
+
+MySqlDumpAdapter::~MySqlDumpAdapter()
+{
+    finishImport();
+}
+
+bool MySqlDumpAdapter::isOpen() const
+{
+    return mOutput->isOpen();
+}
+
+bool MySqlDumpAdapter::finishImport()
+{
+    if( mFinished ) {
+        /// already closed; this just reports how that went
+        return mOutput->close();
+    }
+    mFinished = true;
+    MySqlDatabaseAdapter::finishLoading();
+
+    QElapsedTimer timer;
+    timer.start();
+    mOutput->write( "\n/*!40101 SET SQL_MODE=@OLD_SQL_MODE */;\n"
+                    "/*!40014 SET FOREIGN_KEY_CHECKS=@OLD_FOREIGN_KEY_CHECKS */;\n"
+                    "/*!40014 SET UNIQUE_CHECKS=@OLD_UNIQUE_CHECKS */;\n" );
+    if( !mOutput->close() ) {
+        qCritical() << "MySqlDumpAdapter::finishImport" << "The dump is incomplete.";
+        return false;
+    }
+    qDebug() << "Finished writing the dump in" << timer.elapsed() << "milliseconds";
+    return true;
+}
+
+bool MySqlDumpAdapter::execQuery(const QString &query, const char *context) const
+{
+    Q_UNUSED(context)
+    mOutput->write( query.toUtf8() + "\n" );
+    return true;
+}
+
+bool MySqlDumpAdapter::execBatched(const QString &table, const QString &queryString, const QStringList &placeholders, const QList<QVariantList> &columns)
+{
+    /// every insert query string has the form INSERT INTO `t` (`a`,`b`) VALUES (:x,:y)
+    QRegExp rx("^INSERT INTO `([^`]+)` \\(([^)]*)\\) VALUES \\(([^)]*)\\)");
+    if( rx.indexIn(queryString) < 0 ) {
+        qWarning() << "MySqlDumpAdapter::execBatched" << "Cannot write this as a dump:" << queryString;
+        return false;
+    }
+    QStringList names = rx.cap(2).split(",");
+    QStringList values = rx.cap(3).split(",");
+    QList<int> order;
+    for(int i=0; i<names.count(); i++) {
+        names[i] = names.at(i).trimmed().remove('`').remove('\'');
+        order << placeholders.indexOf( values.at(i).trimmed() );
+        if( order.last() < 0 ) {
+            qWarning() << "MySqlDumpAdapter::execBatched" << "No values for" << names.at(i) << "in" << queryString;
+            return false;
+        }
+    }
+    const int rowCount = columns.first().count();
+
+    int r = 0;
+    writeRows( table, names, [&](QByteArray & row) {
+        if( r >= rowCount ) {
+            return false;
+        }
+        for(int i=0; i<order.count(); i++) {
+            if( i > 0 ) {
+                row += ',';
+            }
+            row += literal( columns.at( order.at(i) ).at(r) );
+        }
+        r++;
+        return true;
+    } );
+    return true;
+}
+
+bool MySqlDumpAdapter::execNodeData(const QString &table, const QString &column, const QVariantList &ids, const QVariantList &values)
+{
+    /// later features of the same nodes fill in their own column of the rows
+    const QByteArray quoted = "`" + column.toUtf8() + "`";
+    int r = 0;
+    writeRows( table, QStringList() << "_id" << column, [&](QByteArray & row) {
+        if( r >= ids.count() ) {
+            return false;
+        }
+        row += QByteArray::number( ids.at(r).toUInt() );
+        row += ',';
+        row += literal( values.at(r) );
+        r++;
+        return true;
+    }, " ON DUPLICATE KEY UPDATE " + quoted + "=VALUES(" + quoted + ")" );
+    return true;
+}
+
+void MySqlDumpAdapter::writeRows(const QString &table, const QStringList &columns, const std::function<bool (QByteArray &)> &nextRow, const QByteArray &suffix)
+{
+    const QByteArray prefix = "INSERT INTO `" + table.toUtf8() + "` (`" + columns.join("`,`").toUtf8() + "`) VALUES ";
+    QByteArray statement;
+    QByteArray row;
+    statement.reserve( StatementBytes + StatementBytes / 4 );
+    forever {
+        row.clear();
+        const bool more = nextRow(row);
+        if( more ) {
+            statement += statement.isEmpty() ? prefix : QByteArray(",");
+            statement += '(';
+            statement += row;
+            statement += ')';
+        }
+        if( !statement.isEmpty() && ( !more || statement.size() >= StatementBytes ) ) {
+            statement += suffix;
+            statement += ";\n";
+            mOutput->write(statement);
+            statement.clear();
+        }
+        if( !more ) {
+            break;
+        }
+    }
+}
+
+QByteArray MySqlDumpAdapter::literal(const QVariant &value)
+{
+    if( value.isNull() ) {
+        return "NULL";
+    }
+    switch( static_cast<QMetaType::Type>(value.type()) ) {
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        return value.toString().toLatin1();
+    case QMetaType::QByteArray:
+        return value.toByteArray().isEmpty() ? QByteArray("''") : "0x" + value.toByteArray().toHex();
+    default:
+        break;
+    }
+
+    /// the characters that mysql_real_escape_string escapes
+    const QByteArray text = value.toString().toUtf8();
+    QByteArray quoted;
+    quoted.reserve( text.size() + 2 );
+    quoted += '\'';
+    for(char c : text) {
+        switch(c) {
+        case '\0': quoted += "\\0"; break;
+        case '\n': quoted += "\\n"; break;
+        case '\r': quoted += "\\r"; break;
+        case '\\': quoted += "\\\\"; break;
+        case '\'': quoted += "\\'"; break;
+        case '"': quoted += "\\\""; break;
+        case '\032': quoted += "\\Z"; break;
+        default: quoted += c;
+        }
+    }
+    quoted += '\'';
+    return quoted;
+}
@@ -0,0 +1,44 @@
+#ifndef MYSQLDUMPADAPTER_H
+#define MYSQLDUMPADAPTER_H
+
+#include "mysqldatabaseadapter.h"
+
+#include <functional>
+#include <memory>
+
+class ParallelGzipWriter;
+
+/// Writes a MySQL dump file instead of talking to a server: every statement
+/// goes to the file as is, and inserted rows become extended INSERT
+/// statements. Each node feature is written as it arrives, as extended
+/// INSERT ... ON DUPLICATE KEY UPDATE statements that fill in its column, so
+/// nothing is held back in memory. A filename ending in .gz is compressed as
+/// it is written.
+class MySqlDumpAdapter : public MySqlDatabaseAdapter
+{
+public:
+    /// @threads compress in parallel; 0 means one per core
+    explicit MySqlDumpAdapter(const QString &filename, int threads = 0);
+    ~MySqlDumpAdapter() override;
+
+    bool isOpen() const override;
+
+    bool finishImport() override;
+
+    /// a MySQL literal for @value, quoted and escaped as mysqldump does
+    static QByteArray literal(const QVariant & value);
+
+protected:
+    bool execBatched(const QString &table, const QString &queryString, const QStringList &placeholders, const QList<QVariantList> &columns) override;
+    bool execNodeData(const QString &table, const QString &column, const QVariantList &ids, const QVariantList &values) override;
+    bool execQuery(const QString &query, const char *context) const override;
+
+private:
+    /// extended INSERTs of at most about StatementBytes each, each ending with @suffix
+    void writeRows(const QString &table, const QStringList &columns, const std::function<bool(QByteArray & row)> &nextRow, const QByteArray &suffix = QByteArray());
+
+    std::unique_ptr<ParallelGzipWriter> mOutput;
+    bool mFinished;
+};
+
+#endif // MYSQLDUMPADAPTER_H
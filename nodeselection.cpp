@@ -0,0 +1,93 @@
+#include "nodeselection.h"
+
+#include <algorithm>
+
+NodeSelection::NodeSelection() :
+    mEverything(true)
+{
+}
+
+NodeSelection::NodeSelection(const Intervals &intervals) :
+    mEverything(false),
+    mIntervals( normalized(intervals) )
+{
+}
+
+bool NodeSelection::isEverything() const
+{
+    return mEverything;
+}
+
+bool NodeSelection::contains(unsigned int node) const
+{
+    if( mEverything ) {
+        return true;
+    }
+    /// the first interval that ends at or after @node
+    auto it = std::lower_bound( mIntervals.constBegin(), mIntervals.constEnd(), node, [](const Interval & interval, unsigned int n) {
+        return interval.second < n;
+    } );
+    return it != mIntervals.constEnd() && it->first <= node;
+}
+
+unsigned int NodeSelection::last() const
+{
+    return mIntervals.isEmpty() ? 0 : mIntervals.last().second;
+}
+
+bool NodeSelection::isPast(unsigned int node) const
+{
+    return !mEverything && ( mIntervals.isEmpty() || node > last() );
+}
+
+NodeSelection::Intervals NodeSelection::clip(const Intervals &intervals) const
+{
+    if( mEverything ) {
+        return intervals;
+    }
+    Intervals result;
+    int i = 0, j = 0;
+    while( i < intervals.count() && j < mIntervals.count() ) {
+        const unsigned int start = qMax( intervals.at(i).first, mIntervals.at(j).first );
+        const unsigned int end = qMin( intervals.at(i).second, mIntervals.at(j).second );
+        if( start <= end ) {
+            result << Interval(start, end);
+        }
+        if( intervals.at(i).second < mIntervals.at(j).second ) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return result;
+}
+
+const NodeSelection::Intervals &NodeSelection::intervals() const
+{
+    return mIntervals;
+}
+
+NodeSelection NodeSelection::intersected(const NodeSelection &other) const
+{
+    if( mEverything ) {
+        return other;
+    }
+    if( other.mEverything ) {
+        return *this;
+    }
+    return NodeSelection( other.clip(mIntervals) );
+}
+
+NodeSelection::Intervals NodeSelection::normalized(Intervals intervals)
+{
+    std::sort( intervals.begin(), intervals.end() );
+    Intervals merged;
+    foreach( const Interval & interval, intervals ) {
+        if( !merged.isEmpty() && static_cast<qint64>(interval.first) <= static_cast<qint64>(merged.last().second) + 1 ) {
+            merged.last().second = qMax( merged.last().second, interval.second );
+        } else {
+            merged << interval;
+        }
+    }
+    return merged;
+}
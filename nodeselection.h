@@ -0,0 +1,44 @@
+#ifndef NODESELECTION_H
+#define NODESELECTION_H
+
+#include <QList>
+#include <QPair>
+
+/// The nodes to import: either every node, or a sorted list of disjoint
+/// inclusive intervals. TFFile applies it while parsing, so that nodes
+/// outside of it are never expanded.
+class NodeSelection
+{
+public:
+    typedef QPair<unsigned int, unsigned int> Interval;
+    typedef QList<Interval> Intervals;
+
+    /// every node
+    NodeSelection();
+    /// just these nodes; @intervals need not be sorted or disjoint
+    explicit NodeSelection(const Intervals & intervals);
+
+    bool isEverything() const;
+    bool contains(unsigned int node) const;
+    /// the largest selected node; only meaningful if !isEverything()
+    unsigned int last() const;
+
+    /// with an ascending file, no line that starts beyond last() can contribute
+    bool isPast(unsigned int node) const;
+
+    /// the parts of @intervals (sorted and disjoint) that are selected
+    Intervals clip(const Intervals & intervals) const;
+
+    const Intervals & intervals() const;
+
+    NodeSelection intersected(const NodeSelection & other) const;
+
+    /// sorted, with overlapping and adjacent intervals merged
+    static Intervals normalized(Intervals intervals);
+
+private:
+    bool mEverything;
+    Intervals mIntervals;
+};
+
+#endif // NODESELECTION_H
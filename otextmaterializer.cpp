@@ -0,0 +1,282 @@
+#include "otextmaterializer.h"
+
+#include <QtDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QRegExp>
+
+#include <algorithm>
+
+#include "abstractdatabaseadapter.h"
+#include "parallel.h"
+#include "tffile.h"
+
+OTextMaterializer::OTextMaterializer(const QDir &folder, AbstractDatabaseAdapter *db, const QHash<QString, QPair<unsigned int, unsigned int> > &oTypeRanges) :
+    mFolder(folder),
+    mDb(db),
+    mOTypeRanges(oTypeRanges),
+    mSlotRange(0, 0)
+{
+    /// the slot type is the one whose nodes come first (word, in the BHSA)
+    bool first = true;
+    QHashIterator<QString,QPair<unsigned int,unsigned int>> i( mOTypeRanges );
+    while (i.hasNext()) {
+        i.next();
+        if( first || i.value().first < mSlotRange.first ) {
+            mSlotRange = i.value();
+            first = false;
+        }
+    }
+}
+
+bool OTextMaterializer::readFormats()
+{
+    const QString path = mFolder.absoluteFilePath("otext.tf");
+    QFile file( path );
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qWarning() << "File could not be opened: " << path;
+        return false;
+    }
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+
+    /// otext.tf is all header, e.g., @fmt:text-orig-full={g_word_utf8}{trailer_utf8}
+    QRegExp rx("^@fmt:([^=]+)=(.*)$");
+    while( !in.atEnd() ) {
+        const QString ln = in.readLine();
+        if( ln.isEmpty() || ln.at(0) != '@' ) {
+            break;
+        }
+        if( rx.indexIn(ln) > -1 ) {
+            mFormats.insert( rx.cap(1), parseTemplate( rx.cap(2) ) );
+        }
+    }
+    return !mFormats.isEmpty();
+}
+
+void OTextMaterializer::setSelection(const NodeSelection &selection)
+{
+    mSelection = selection;
+}
+
+QString OTextMaterializer::tableNameForFormat(const QString &format)
+{
+    return "otext_" + QString(format).replace('-', '_');
+}
+
+OTextMaterializer::Template OTextMaterializer::parseTemplate(const QString &templateString)
+{
+    Template t;
+    int pos = 0;
+    while( pos < templateString.length() ) {
+        const int open = templateString.indexOf('{', pos);
+        const int close = open < 0 ? -1 : templateString.indexOf('}', open);
+        if( open < 0 || close < 0 ) {
+            Segment literal;
+            literal.literal = TFFile::unescape( templateString.mid(pos) );
+            t << literal;
+            break;
+        }
+        if( open > pos ) {
+            Segment literal;
+            literal.literal = TFFile::unescape( templateString.mid(pos, open - pos) );
+            t << literal;
+        }
+        /// {a/b} means the value of a, or of b if a is empty
+        Segment substitution;
+        substitution.features = templateString.mid(open + 1, close - open - 1).split('/');
+        t << substitution;
+        pos = close + 1;
+    }
+    return t;
+}
+
+void OTextMaterializer::materialize(const QStringList &otypes)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    loadSlotFeatures();
+    loadSlots(otypes);
+
+    QMapIterator<QString,Template> f(mFormats);
+    while( f.hasNext() ) {
+        f.next();
+        const QVector<QString> slotText = renderSlots( f.value() );
+        const QString table = tableNameForFormat( f.key() );
+
+        QSet<QString> columns;
+        QHash<QString, QString> columnTypes;
+        columns << "_id" << "otype" << "text";
+        columnTypes["_id"] = mDb->primaryKeyType();
+        columnTypes["otype"] = mDb->stringType();
+        columnTypes["text"] = mDb->longTextType();
+        mDb->createTable( table, columns, columnTypes );
+
+        foreach( QString otype, otypes ) {
+            if( !mSlots.contains(otype) ) {
+                continue;
+            }
+            const QVector<QVector<unsigned int>> & nodeSlots = mSlots[otype];
+            const unsigned int start = mOTypeRanges.value(otype).first;
+
+            QVector<QString> texts( nodeSlots.count() );
+            parallelFor( 0, nodeSlots.count(), [&](int begin, int end) {
+                for(int n = begin; n < end; n++) {
+                    if( !mSelection.contains( start + static_cast<unsigned int>(n) ) ) {
+                        continue;
+                    }
+                    QString text;
+                    foreach( unsigned int slot, nodeSlots.at(n) ) {
+                        text += slotText.at( static_cast<int>(slot - mSlotRange.first) );
+                    }
+                    texts[n] = text;
+                }
+            } );
+
+            QVariantList ids, types, values;
+            ids.reserve( texts.count() );
+            types.reserve( texts.count() );
+            values.reserve( texts.count() );
+            for(int n = 0; n < texts.count(); n++) {
+                if( !mSelection.contains( start + static_cast<unsigned int>(n) ) ) {
+                    continue;
+                }
+                ids << start + static_cast<unsigned int>(n);
+                types << otype;
+                values << texts.at(n);
+            }
+            mDb->insertRows( table, QStringList() << "_id" << "otype" << "text", QList<QVariantList>() << ids << types << values );
+        }
+    }
+
+    qDebug() << "Materialized" << mFormats.count() << "text formats in" << timer.elapsed() << "milliseconds";
+}
+
+void OTextMaterializer::loadSlotFeatures()
+{
+    QSet<QString> features;
+    foreach( Template t, mFormats ) {
+        foreach( Segment s, t ) {
+            foreach( QString feature, s.features ) {
+                features << feature;
+            }
+        }
+    }
+
+    const int slotCount = static_cast<int>(mSlotRange.second - mSlotRange.first + 1);
+    foreach( QString feature, features ) {
+        const QFileInfo info( mFolder.absoluteFilePath(feature + ".tf") );
+        if( !info.exists() ) {
+            qWarning() << "OTextMaterializer::loadSlotFeatures" << "A format uses a feature that is not in the folder:" << feature;
+            continue;
+        }
+        QVector<QString> & values = mSlotFeatures[feature];
+        values.resize(slotCount);
+        TFFile(info).readNodes( [&](unsigned int node, const QString & value) {
+            if( node >= mSlotRange.first && node <= mSlotRange.second ) {
+                values[ static_cast<int>(node - mSlotRange.first) ] = value;
+            }
+        } );
+    }
+}
+
+void OTextMaterializer::loadSlots(const QStringList &otypes)
+{
+    QList<QPair<unsigned int,unsigned int>> ranges;
+    foreach( QString otype, otypes ) {
+        if( !mOTypeRanges.contains(otype) ) {
+            qWarning() << "OTextMaterializer::loadSlots" << "Unknown otype:" << otype;
+            continue;
+        }
+        const QPair<unsigned int,unsigned int> range = mOTypeRanges.value(otype);
+        QVector<QVector<unsigned int>> & nodeSlots = mSlots[otype];
+        nodeSlots.resize( static_cast<int>(range.second - range.first + 1) );
+        if( range == mSlotRange ) {
+            /// a slot contains itself
+            for(unsigned int s = range.first; s <= range.second; s++) {
+                nodeSlots[ static_cast<int>(s - range.first) ] << s;
+            }
+        } else {
+            ranges << range;
+        }
+    }
+    if( ranges.isEmpty() ) {
+        return;
+    }
+
+    /// oslots is ordered by node, so the last otype looked up is nearly always the next one
+    QString currentOType;
+    QPair<unsigned int,unsigned int> currentRange(1, 0);
+    TFFile( QFileInfo( mFolder.absoluteFilePath("oslots.tf") ) ).readEdges( [&](unsigned int from, unsigned int to, const QString & value) {
+        Q_UNUSED(value)
+        if( !mSelection.contains(from) ) {
+            return;
+        }
+        if( from < currentRange.first || from > currentRange.second ) {
+            currentOType.clear();
+            foreach( QString otype, mSlots.keys() ) {
+                const QPair<unsigned int,unsigned int> range = mOTypeRanges.value(otype);
+                if( from >= range.first && from <= range.second ) {
+                    currentOType = otype;
+                    currentRange = range;
+                    break;
+                }
+            }
+            if( currentOType.isEmpty() ) {
+                return;
+            }
+        }
+        mSlots[currentOType][ static_cast<int>(from - currentRange.first) ] << to;
+    } );
+
+    /// the slots of a node must be in text order
+    foreach( QString otype, mSlots.keys() ) {
+        QVector<QVector<unsigned int>> & nodeSlots = mSlots[otype];
+        parallelFor( 0, nodeSlots.count(), [&](int begin, int end) {
+            for(int n = begin; n < end; n++) {
+                std::sort( nodeSlots[n].begin(), nodeSlots[n].end() );
+            }
+        } );
+    }
+}
+
+QVector<QString> OTextMaterializer::renderSlots(const Template &fmt) const
+{
+    const int slotCount = static_cast<int>(mSlotRange.second - mSlotRange.first + 1);
+    QVector<QString> text(slotCount);
+
+    /// look the features up once, not once per slot
+    QList<QList<const QVector<QString>*>> sources;
+    foreach( const Segment & segment, fmt ) {
+        QList<const QVector<QString>*> alternatives;
+        foreach( const QString & feature, segment.features ) {
+            if( mSlotFeatures.contains(feature) ) {
+                alternatives << &mSlotFeatures.find(feature).value();
+            }
+        }
+        sources << alternatives;
+    }
+
+    parallelFor( 0, slotCount, [&](int begin, int end) {
+        for(int s = begin; s < end; s++) {
+            QString rendered;
+            for(int i = 0; i < fmt.count(); i++) {
+                if( fmt.at(i).features.isEmpty() ) {
+                    rendered += fmt.at(i).literal;
+                    continue;
+                }
+                foreach( const QVector<QString> * values, sources.at(i) ) {
+                    if( !values->at(s).isEmpty() ) {
+                        rendered += values->at(s);
+                        break;
+                    }
+                }
+            }
+            text[s] = rendered;
+        }
+    } );
+    return text;
+}
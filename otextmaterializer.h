@@ -0,0 +1,62 @@
+#ifndef OTEXTMATERIALIZER_H
+#define OTEXTMATERIALIZER_H
+
+#include <QDir>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+#include "nodeselection.h"
+
+class AbstractDatabaseAdapter;
+
+/// Renders the @fmt:* templates of otext.tf for whole section-level nodes
+/// (book, chapter, verse, ...) and stores the results in one table per
+/// format, so that displaying a section is a single lookup.
+class OTextMaterializer
+{
+public:
+    OTextMaterializer(const QDir & folder, AbstractDatabaseAdapter * db, const QHash<QString,QPair<unsigned int,unsigned int>> & oTypeRanges);
+
+    /// read the formats from otext.tf; false if there are none
+    bool readFormats();
+
+    /// only selected nodes get text (their slots need not be selected)
+    void setSelection(const NodeSelection & selection);
+
+    /// create and fill an otext_<format> table for each format, with a row
+    /// for every selected node of the given otypes
+    void materialize(const QStringList & otypes);
+
+    static QString tableNameForFormat(const QString & format);
+
+private:
+    /// a template is a list of literal strings and {feature1/feature2} substitutions
+    struct Segment {
+        QString literal;
+        QStringList features;
+    };
+    typedef QList<Segment> Template;
+
+    static Template parseTemplate(const QString & templateString);
+
+    void loadSlotFeatures();
+    void loadSlots(const QStringList & otypes);
+    QVector<QString> renderSlots(const Template & fmt) const;
+
+    QDir mFolder;
+    AbstractDatabaseAdapter * mDb;
+    QHash<QString,QPair<unsigned int,unsigned int>> mOTypeRanges;
+    QPair<unsigned int,unsigned int> mSlotRange;
+    NodeSelection mSelection;
+
+    QMap<QString,Template> mFormats;
+    /// feature -> value, indexed by slot - mSlotRange.first
+    QHash<QString,QVector<QString>> mSlotFeatures;
+    /// otype -> slots of each node, indexed by node - start of the otype's range
+    QHash<QString,QVector<QVector<unsigned int>>> mSlots;
+};
+
+#endif // OTEXTMATERIALIZER_H
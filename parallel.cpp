@@ -0,0 +1,29 @@
+#include "parallel.h"
+
+#include <QThread>
+
+#include <thread>
+#include <vector>
+
+void parallelFor(int begin, int end, const std::function<void(int,int)> &body)
+{
+    const int count = end - begin;
+    if( count <= 0 ) {
+        return;
+    }
+    const int threadCount = qBound(1, QThread::idealThreadCount(), count);
+    if( threadCount == 1 ) {
+        body(begin, end);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    const int chunk = (count + threadCount - 1) / threadCount;
+    for(int start = begin; start < end; start += chunk) {
+        const int stop = qMin(end, start + chunk);
+        threads.emplace_back( [&body, start, stop]() { body(start, stop); } );
+    }
+    for(std::thread & t : threads) {
+        t.join();
+    }
+}
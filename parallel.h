@@ -0,0 +1,10 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+/// Split [begin, end) into contiguous chunks and run @body(chunkBegin, chunkEnd)
+/// on each from a pool of threads (one per core). Returns when all are done.
+void parallelFor(int begin, int end, const std::function<void(int,int)> & body);
+
+#endif // PARALLEL_H
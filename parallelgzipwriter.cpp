@@ -0,0 +1,200 @@
+#include "parallelgzipwriter.h"
+
+#include <QtDebug>
+#include <QMutexLocker>
+
+#include <zlib.h>
+
+namespace {
+/// large enough that the per-member overhead and the lost context don't matter
+const int BlockSize = 4 * 1024 * 1024;
+}
+
+ParallelGzipWriter::ParallelGzipWriter(const QString &filename, int threads, int level) :
+    mFile(filename),
+    mCompress( filename.endsWith(".gz", Qt::CaseInsensitive) ),
+    mLevel(level),
+    mThreadCount( threads > 0 ? threads : qMax( 1, static_cast<int>(std::thread::hardware_concurrency()) ) ),
+    mFailed(false),
+    mStopping(false)
+{
+    if( !mFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        qCritical() << "ParallelGzipWriter::ParallelGzipWriter" << "Could not open" << filename << mFile.errorString();
+        mFailed = true;
+        return;
+    }
+    if( mCompress ) {
+        for(int i = 0; i < mThreadCount; i++) {
+            mThreads.emplace_back( [this]() { compressLoop(); } );
+        }
+    }
+}
+
+ParallelGzipWriter::~ParallelGzipWriter()
+{
+    close();
+}
+
+bool ParallelGzipWriter::isOpen() const
+{
+    return mFile.isOpen();
+}
+
+void ParallelGzipWriter::write(const QByteArray &data)
+{
+    if( !mFile.isOpen() ) {
+        return;
+    }
+    if( !mCompress ) {
+        writeToFile(data);
+        return;
+    }
+    mPending.append(data);
+    if( mPending.size() >= BlockSize ) {
+        submit();
+    }
+}
+
+void ParallelGzipWriter::submit()
+{
+    std::shared_ptr<Block> block( new Block );
+    block->input.swap(mPending);
+    block->done = false;
+    mPending.reserve(BlockSize + BlockSize / 4);
+
+    QList<QByteArray> ready;
+    {
+        QMutexLocker locker(&mMutex);
+        /// two blocks per thread keeps everyone busy without holding the whole file in memory
+        while( mInFlight.count() >= 2 * mThreadCount ) {
+            takeFinishedBlocks(ready);
+            if( mInFlight.count() >= 2 * mThreadCount ) {
+                mBlockDone.wait(&mMutex);
+            }
+        }
+        mWaiting.enqueue(block);
+        mInFlight.enqueue(block);
+        mWorkAvailable.wakeOne();
+        takeFinishedBlocks(ready);
+    }
+    foreach( const QByteArray & output, ready ) {
+        writeToFile(output);
+    }
+}
+
+void ParallelGzipWriter::takeFinishedBlocks(QList<QByteArray> &ready)
+{
+    while( !mInFlight.isEmpty() && mInFlight.head()->done ) {
+        ready << mInFlight.dequeue()->output;
+    }
+}
+
+void ParallelGzipWriter::writeToFile(const QByteArray &data)
+{
+    /// a block that could not be compressed comes back empty
+    if( data.isEmpty() ) {
+        mFailed = true;
+        return;
+    }
+    if( mFile.write(data) != data.size() ) {
+        qCritical() << "ParallelGzipWriter::writeToFile" << mFile.fileName() << mFile.errorString();
+        mFailed = true;
+    }
+}
+
+void ParallelGzipWriter::compressLoop()
+{
+    QMutexLocker locker(&mMutex);
+    forever {
+        while( mWaiting.isEmpty() && !mStopping ) {
+            mWorkAvailable.wait(&mMutex);
+        }
+        if( mWaiting.isEmpty() ) {
+            return;
+        }
+        std::shared_ptr<Block> block = mWaiting.dequeue();
+
+        locker.unlock();
+        QByteArray output = gzipMember( block->input, mLevel );
+        locker.relock();
+
+        block->output.swap(output);
+        block->input.clear();
+        block->done = true;
+        mBlockDone.wakeAll();
+    }
+}
+
+bool ParallelGzipWriter::close()
+{
+    if( !mFile.isOpen() ) {
+        return !mFailed;
+    }
+    if( mCompress ) {
+        if( !mPending.isEmpty() ) {
+            submit();
+        }
+        forever {
+            QList<QByteArray> ready;
+            bool finished;
+            {
+                QMutexLocker locker(&mMutex);
+                takeFinishedBlocks(ready);
+                if( ready.isEmpty() && !mInFlight.isEmpty() ) {
+                    mBlockDone.wait(&mMutex);
+                    takeFinishedBlocks(ready);
+                }
+                finished = mInFlight.isEmpty();
+                if( finished ) {
+                    mStopping = true;
+                    mWorkAvailable.wakeAll();
+                }
+            }
+            foreach( const QByteArray & output, ready ) {
+                writeToFile(output);
+            }
+            if( finished ) {
+                break;
+            }
+        }
+        for(std::thread & thread : mThreads) {
+            thread.join();
+        }
+        mThreads.clear();
+    }
+    if( !mFile.flush() ) {
+        qCritical() << "ParallelGzipWriter::close" << mFile.fileName() << mFile.errorString();
+        mFailed = true;
+    }
+    mFile.close();
+    return !mFailed;
+}
+
+QByteArray ParallelGzipWriter::gzipMember(const QByteArray &input, int level)
+{
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    /// 15 + 16: the largest window, with a gzip header and trailer
+    if( deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK ) {
+        qCritical() << "ParallelGzipWriter::gzipMember" << "deflateInit2 failed";
+        return QByteArray();
+    }
+
+    QByteArray output;
+    output.resize( static_cast<int>( deflateBound(&stream, static_cast<uLong>(input.size())) ) + 64 );
+    stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>(input.constData()) );
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>( output.data() );
+    stream.avail_out = static_cast<uInt>(output.size());
+
+    if( deflate(&stream, Z_FINISH) != Z_STREAM_END ) {
+        qCritical() << "ParallelGzipWriter::gzipMember" << "deflate did not finish";
+        deflateEnd(&stream);
+        return QByteArray();
+    }
+    output.resize( static_cast<int>(stream.total_out) );
+    deflateEnd(&stream);
+    return output;
+}
@@ -0,0 +1,69 @@
+#ifndef PARALLELGZIPWRITER_H
+#define PARALLELGZIPWRITER_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+/// Writes a file through a pool of compressing threads. Output is cut into
+/// blocks, each block is compressed on its own into a complete gzip member,
+/// and the members are written in order; gzip readers treat a series of
+/// members as one stream. Filenames that don't end in .gz are written as is.
+class ParallelGzipWriter
+{
+public:
+    /// @threads 0 means one per core
+    explicit ParallelGzipWriter(const QString & filename, int threads = 0, int level = 6);
+    ~ParallelGzipWriter();
+
+    bool isOpen() const;
+
+    void write(const QByteArray & data);
+
+    /// compress and write whatever is left, and close the file; false if
+    /// the file could not be opened or any part of it could not be written
+    bool close();
+
+private:
+    struct Block {
+        QByteArray input;
+        QByteArray output;
+        bool done;
+    };
+
+    void submit();
+    /// move the output of the finished blocks at the front to @ready; the mutex must be held
+    void takeFinishedBlocks(QList<QByteArray> & ready);
+    /// write to the file, without the mutex, so that compressing carries on meanwhile
+    void writeToFile(const QByteArray & data);
+    void compressLoop();
+
+    static QByteArray gzipMember(const QByteArray & input, int level);
+
+    QFile mFile;
+    bool mCompress;
+    int mLevel;
+    int mThreadCount;
+    QByteArray mPending;
+    /// only touched by the thread that writes
+    bool mFailed;
+
+    QMutex mMutex;
+    QWaitCondition mWorkAvailable;
+    QWaitCondition mBlockDone;
+    /// waiting to be compressed
+    QQueue<std::shared_ptr<Block>> mWaiting;
+    /// everything not yet written, in output order
+    QQueue<std::shared_ptr<Block>> mInFlight;
+    bool mStopping;
+    std::vector<std::thread> mThreads;
+};
+
+#endif // PARALLELGZIPWRITER_H
@@ -1,11 +1,18 @@
 #include "reader.h"
 #include "abstractdatabaseadapter.h"
+#include "otextmaterializer.h"
+#include "bitmapindex.h"
+#include "wordcontext.h"
+#include "parallel.h"
 
 #include <QString>
-#include <QSetIterator>
+#include <QThread>
 #include <QTimer>
 
-Reader::Reader(const QString &folderPath, AbstractDatabaseAdapter *db) : mDb(db), mFolder(folderPath)
+#include <algorithm>
+#include <vector>
+
+Reader::Reader(const QString &folderPath, AbstractDatabaseAdapter *db) : mDb(db), mFolder(folderPath), mIsVersion(false)
 {
     mFilesToSkip << "otype.tf" << "otext.tf" << "omap@2017-2021.tf" << "omap@c-2021.tf";
 }
@@ -17,60 +24,374 @@ Reader::~Reader()
 void Reader::loadData()
 {
     mDb->beginTransaction();
+    mDb->beginLoading();
 
     /// get the otypes
     processOtypeFile();
 
+    resolveSelection();
+
     mDb->setOtypeRanges( mOTypeRanges );
 
+    if( mIsVersion ) {
+        mDb->setTableSuffix( "_" + version() );
+        /// views from an earlier run would block the new tables
+        foreach( QString otype, mOTypeRanges.keys() ) {
+            mDb->dropView( mDb->tableName(otype) );
+        }
+    }
+
     /// load the files and read the relevant header-type information
     QFileInfoList fileList = mFolder.entryInfoList(QStringList("*.tf"),QDir::Files);
     foreach(QFileInfo info, fileList) {
-        if( ! mFilesToSkip.contains( info.fileName() ) ) {
-            mFiles << TFFile(info);
+        if( mFilesToSkip.contains( info.fileName() ) ) {
+            continue;
         }
+        if( !mFeatures.isEmpty() && !mFeatures.contains( info.baseName() ) ) {
+            continue;
+        }
+        TFFile file(info);
+        file.setSelection( mSelection );
+        mFiles << file;
     }
 
+    scanFiles();
+
     /// create tables based on what was collected in the first pass
     createTables();
 
 
-    for(int i=0; i<mFiles.count(); i++) {
-        QElapsedTimer timer;
-        timer.start();
-        qInfo().noquote() << "Reading:" << mFiles.at(i).label();
-        mFiles[i].addDataToDatabase(mDb);
-        qDebug() << "Completed in" << timer.elapsed() << "milliseconds";
+    /// When the adapter writes from its own threads, the files are parsed a
+    /// group at a time in parallel, and then handed over in order; otherwise
+    /// parsing and writing alternate on this thread.
+    const bool parseAhead = mDb->writesInBackground();
+    const int groupSize = parseAhead ? qMax( 1, QThread::idealThreadCount() ) : 1;
+    for(int first=0; first<mFiles.count(); first += groupSize) {
+        const int last = qMin( first + groupSize, mFiles.count() );
+        if( parseAhead ) {
+            /// detach the list here, not from the threads
+            std::vector<TFFile*> group;
+            for(int i=first; i<last; i++) {
+                if( mFiles.at(i).canParseRowsFor(mDb) ) {
+                    group.push_back( &mFiles[i] );
+                }
+            }
+            QElapsedTimer timer;
+            timer.start();
+            parallelFor( 0, static_cast<int>(group.size()), [&](int begin, int end) {
+                for(int i = begin; i < end; i++) {
+                    group[i]->parseRows();
+                }
+            } );
+            qDebug() << "Parsed" << group.size() << "files in" << timer.elapsed() << "milliseconds";
+        }
+
+        for(int i=first; i<last; i++) {
+            QElapsedTimer timer;
+            timer.start();
+            qInfo().noquote() << "Reading:" << mFiles.at(i).label();
+            mFiles[i].addDataToDatabase(mDb);
+            qDebug() << "Completed in" << timer.elapsed() << "milliseconds";
+        }
+    }
+
+    mDb->finishLoading();
+
+    if( mDb->storesEdgeRanges() ) {
+        for(int i=0; i<mFiles.count(); i++) {
+            if( mFiles.at(i).fileType() == TFFile::FileTypeEdge ) {
+                mDb->createEdgeRangeView( mFiles.at(i).label() );
+            }
+        }
+    }
+
+    if( !mFullTextFeatures.isEmpty() && !mIsVersion ) {
+        createFullTextIndexes();
+    }
+
+    if( !mBitmapFeatures.isEmpty() && !mIsVersion ) {
+        QList<TFFile> files;
+        foreach( TFFile file, mFiles ) {
+            if( mBitmapFeatures.contains( file.label() ) ) {
+                files << file;
+            }
+        }
+        BitmapIndex( mDb ).build( files );
+    }
+
+    if( !mOTextTypes.isEmpty() ) {
+        OTextMaterializer otext( mFolder, mDb, mOTypeRanges );
+        otext.setSelection( mSelection );
+        if( otext.readFormats() ) {
+            otext.materialize( mOTextTypes );
+        }
+    }
+
+    if( !mContextLevels.isEmpty() ) {
+        WordContext context( mFolder, mDb, mOTypeRanges );
+        context.setSelection( mSelection );
+        context.build( mContextLevels );
+    }
+
+    if( mIsVersion ) {
+        deduplicateAgainstBase();
+        mDb->setTableSuffix( QString() );
     }
 
     mDb->commitTransaction();
+
+    qInfo().noquote() << "Batch size" << ( mDb->batchSizeSettled() ? "settled at" : "still tuning at" ) << mDb->batchSize()
+                      << "rows; commit size" << ( mDb->commitSizeSettled() ? "settled at" : "still tuning at" ) << mDb->commitSize() << "rows";
 }
 
-void Reader::processOtypeFile()
+void Reader::setBaseVersion(const QString &baseFolderPath)
+{
+    mBaseFolder = QDir(baseFolderPath);
+    mIsVersion = true;
+}
+
+void Reader::scanFiles()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<TFFile> files( mFiles.begin(), mFiles.end() );
+    parallelFor( 0, static_cast<int>(files.size()), [&](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            files[i].scanStatistics( mOTypeRanges );
+        }
+    } );
+
+    /// files are parsed a group at a time when the adapter writes in the background;
+    /// largest first, each group holds files of similar size and finishes together
+    if( mDb->writesInBackground() ) {
+        std::stable_sort( files.begin(), files.end(), [](const TFFile & a, const TFFile & b) {
+            return a.statistics().rowCount > b.statistics().rowCount;
+        } );
+    }
+    mFiles.clear();
+    for(const TFFile & file : files) {
+        mFiles << file;
+    }
+
+    qDebug() << "Scanned" << mFiles.count() << "files in" << timer.elapsed() << "milliseconds";
+}
+
+void Reader::setContextLevels(const QStringList &levels)
+{
+    mContextLevels = levels;
+}
+
+void Reader::setNodeRanges(const QString &ranges)
+{
+    mNodeRanges = ranges;
+}
+
+void Reader::setBooks(const QStringList &books)
+{
+    mBooks = books;
+}
+
+void Reader::setOtypes(const QStringList &otypes)
+{
+    mSelectedOtypes = otypes;
+}
+
+void Reader::setFeatures(const QStringList &features)
+{
+    mFeatures = features;
+}
+
+void Reader::resolveSelection()
+{
+    NodeSelection selection;
+
+    if( !mNodeRanges.isEmpty() ) {
+        selection = NodeSelection( TFFile::nodeRangeToIntervals( mNodeRanges ) );
+    }
+
+    if( !mSelectedOtypes.isEmpty() ) {
+        foreach( QString otype, mSelectedOtypes ) {
+            if( !mOTypeRanges.contains(otype) ) {
+                qWarning() << "No such otype:" << otype;
+            }
+        }
+        NodeSelection::Intervals ranges;
+        foreach( QString otype, mOTypeRanges.keys() ) {
+            if( mSelectedOtypes.contains(otype) ) {
+                ranges << mOTypeRanges.value(otype);
+            } else {
+                /// no table for it, and no node of it gets past the selection
+                mOTypeRanges.remove(otype);
+            }
+        }
+        selection = selection.intersected( NodeSelection(ranges) );
+    }
+
+    if( !mBooks.isEmpty() ) {
+        selection = selection.intersected( bookSelection() );
+    }
+
+    mSelection = selection;
+
+    if( !mSelection.isEverything() ) {
+        qint64 count = 0;
+        foreach( const NodeSelection::Interval & interval, mSelection.intervals() ) {
+            count += interval.second - interval.first + 1;
+        }
+        qInfo() << "Importing" << count << "nodes in" << mSelection.intervals().count() << "ranges";
+    }
+}
+
+NodeSelection Reader::bookSelection() const
+{
+    const QFileInfo bookInfo( mFolder.absoluteFilePath("book.tf") );
+    const QFileInfo oslotsInfo( mFolder.absoluteFilePath("oslots.tf") );
+    if( !bookInfo.exists() || !oslotsInfo.exists() ) {
+        qCritical() << "Selecting books needs book.tf and oslots.tf in" << mFolder.absolutePath();
+        return NodeSelection( NodeSelection::Intervals() );
+    }
+
+    const QSet<QString> names( mBooks.begin(), mBooks.end() );
+    NodeSelection::Intervals books;
+    TFFile(bookInfo).readNodes( [&](unsigned int node, const QString & value) {
+        if( names.contains(value) ) {
+            books << NodeSelection::Interval(node, node);
+        }
+    } );
+    if( books.count() < names.count() ) {
+        qWarning() << "Found" << books.count() << "of the books" << mBooks;
+    }
+    const NodeSelection bookNodes( books );
+
+    /// first the slots of the books, then every node with a slot among them
+    TFFile oslots(oslotsInfo);
+    NodeSelection::Intervals slots;
+    oslots.readEdgeRanges( [&](const TFFile::Intervals & froms, const TFFile::Intervals & tos, const QString &) {
+        if( !bookNodes.clip(froms).isEmpty() ) {
+            slots << tos;
+        }
+    } );
+    const NodeSelection slotSelection( slots );
+
+    NodeSelection::Intervals nodes = slotSelection.intervals();
+    oslots.readEdgeRanges( [&](const TFFile::Intervals & froms, const TFFile::Intervals & tos, const QString &) {
+        if( !slotSelection.clip(tos).isEmpty() ) {
+            nodes << froms;
+        }
+    } );
+    return NodeSelection( nodes );
+}
+
+void Reader::setFullTextFeatures(const QStringList &features, const QString &tokenizer)
+{
+    mFullTextFeatures = features;
+    mFullTextTokenizer = tokenizer;
+}
+
+void Reader::setOTextTypes(const QStringList &otypes)
+{
+    mOTextTypes = otypes;
+}
+
+void Reader::setBitmapFeatures(const QStringList &features)
+{
+    mBitmapFeatures = features;
+}
+
+void Reader::createFullTextIndexes()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    /// only string features make sense in a full-text index
+    QSet<QString> stringFeatures;
+    foreach( TFFile file, mFiles ) {
+        if( file.fileType() == TFFile::FileTypeNode && file.valueType() == TFFile::ValueTypeString && mFullTextFeatures.contains( file.label() ) ) {
+            stringFeatures << file.label();
+        }
+    }
+
+    foreach( QString otype, mOTypeRanges.keys() ) {
+        QStringList columns;
+        foreach( QString feature, mFullTextFeatures ) {
+            if( stringFeatures.contains(feature) && mDb->tableColumns(otype).contains(feature) ) {
+                columns << feature;
+            }
+        }
+        if( !columns.isEmpty() ) {
+            qInfo().noquote() << "Full-text index:" << otype << columns.join(", ");
+            mDb->createFullTextIndex( otype, columns, mFullTextTokenizer );
+        }
+    }
+
+    qDebug() << "Full-text indexes built in" << timer.elapsed() << "milliseconds";
+}
+
+QString Reader::version() const
 {
-    QString path = mFolder.absoluteFilePath("otype.tf");
-    QFile file( path );
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        qWarning() << "File could not be opened: " << path;
+    return mFolder.dirName();
+}
+
+void Reader::loadOmap()
+{
+    /// e.g., omap@2017-2021.tf maps 2017 nodes onto 2021 nodes
+    const QFileInfo info( mBaseFolder.absoluteFilePath( "omap@" + version() + "-" + mBaseFolder.dirName() + ".tf" ) );
+    if( !info.exists() ) {
+        qCritical() << "No node mapping found for version" << version() << ":" << info.absoluteFilePath();
+        return;
     }
 
-    QTextStream in(&file);
+    QVariantList froms, tos, values;
+    TFFile(info).readEdges(froms, tos, values);
+
+    /// only one-to-one mappings can share a row
+    QHash<unsigned int,int> targetCount;
+    for(int i=0; i<froms.count(); i++) {
+        targetCount[ froms.at(i).toUInt() ]++;
+    }
+    QVariantList uniqueFroms, uniqueTos;
+    for(int i=0; i<froms.count(); i++) {
+        if( targetCount.value( froms.at(i).toUInt() ) == 1 ) {
+            uniqueFroms << froms.at(i);
+            uniqueTos << tos.at(i);
+        }
+    }
 
-    // skip past header
-    QString ln;
-    do {
-        ln = in.readLine();
-    } while( ln.length() > 0 && ln.at(0) == "@" );
+    QSet<QString> columns;
+    QHash<QString, QString> columnTypes;
+    columns << "from_node" << "to_node";
+    columnTypes["from_node"] = mDb->primaryKeyType();
+    columnTypes["to_node"] = mDb->integerType();
+    mDb->createTable( "omap", columns, columnTypes );
+    mDb->insertRows( "omap", QStringList() << "from_node" << "to_node", QList<QVariantList>() << uniqueFroms << uniqueTos );
 
-    QRegExp rx("^(.*)-(.*)\t(.*)$");
-    do {
-        ln = in.readLine();
-        int pos = rx.indexIn(ln);
-        if (pos > -1) {
-            mOTypeRanges[ rx.cap(3) ] = QPair<unsigned int,unsigned int>( rx.cap(1).toUInt(), rx.cap(2).toUInt() );
+    qInfo() << "Mapped" << uniqueFroms.count() << "of" << targetCount.count() << "nodes of version" << version() << "onto" << mBaseFolder.dirName();
+}
+
+void Reader::deduplicateAgainstBase()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    loadOmap();
+
+    QHashIterator<QString,QPair<unsigned int,unsigned int>> i( mOTypeRanges );
+    while (i.hasNext()) {
+        i.next();
+        /// a table the base version doesn't have is kept whole
+        if( mDb->tableColumns( i.key() ).isEmpty() ) {
+            continue;
         }
-    } while( !in.atEnd() );
+        mDb->deduplicateAgainstBase( mDb->tableName(i.key()), i.key(), mDb->tableName("omap"), i.value() );
+    }
+
+    qDebug() << "Deduplicated version" << version() << "in" << timer.elapsed() << "milliseconds";
+}
+
+void Reader::processOtypeFile()
+{
+    mOTypeRanges = TFFile::readOTypeRanges( mFolder.absoluteFilePath("otype.tf") );
 }
 
 void Reader::createTables()
@@ -78,14 +399,22 @@ void Reader::createTables()
     /// NB: this able works differently from the others
     mDb->createOTypeTable();
 
-    /// first the node tables
+    /// first the node tables, each with a column for every feature that the scan found on that otype,
+    /// so that no ALTER TABLE is needed once data are going in
     foreach( QString otype, mOTypeRanges.keys() ) { /// word, book, chapter, clause... etc. Each will be a different table.
         QSet<QString> node_columns;
         QHash<QString, QString> node_columnTypes;
-        QString dataType;
 
         node_columns << "_id";
-        node_columnTypes["_id"] = "int primary key"; /// this works for both SQLite and MySQL
+        node_columnTypes["_id"] = mDb->primaryKeyType(); /// clustered on _id for both SQLite and MySQL
+
+        for(int i=0; i<mFiles.count(); i++) {
+            if( mFiles.at(i).fileType() == TFFile::FileTypeNode && mFiles.at(i).statistics().otypes.contains(otype) ) {
+                node_columns << mFiles.at(i).label();
+                node_columnTypes[ mFiles.at(i).label() ] = mDb->sqlDataType( mFiles.at(i).valueType(), mFiles.at(i).statistics() );
+            }
+        }
+
         mDb->createTable( otype, node_columns, node_columnTypes );
     }
 
@@ -96,10 +425,18 @@ void Reader::createTables()
             QHash<QString, QString> edge_columnTypes;
 
             edge_columns << "value";
-            if( mFiles.at(i).valueType() == TFFile::ValueTypeInteger ) {
-                edge_columnTypes["value"] = mDb->integerType();
-            } else if( mFiles.at(i).valueType() == TFFile::ValueTypeString ) {
-                edge_columnTypes["value"] = mDb->stringType();
+            edge_columnTypes["value"] = mDb->sqlDataType( mFiles.at(i).valueType(), mFiles.at(i).statistics() );
+
+            if( mDb->storesEdgeRanges() ) {
+                edge_columns << "from_start" << "from_end" << "to_start" << "to_end";
+                edge_columnTypes["from_start"] =  mDb->integerType();
+                edge_columnTypes["from_end"] =  mDb->integerType();
+                edge_columnTypes["to_start"] =  mDb->integerType();
+                edge_columnTypes["to_end"] =  mDb->integerType();
+
+                /// the view, made after loading, takes the filename
+                mDb->createTable( AbstractDatabaseAdapter::edgeRangeTableName( mFiles.at(i).label() ), edge_columns, edge_columnTypes );
+                continue;
             }
 
             edge_columns << "from_node" << "to_node";
@@ -107,7 +444,7 @@ void Reader::createTables()
             edge_columnTypes["to_node"] =  mDb->integerType();
 
             /// edge tables should be labled with the filename
-            mDb->createTable( mFiles.at(i).label(), edge_columns, edge_columnTypes );
+            mDb->createTable( mFiles.at(i).label(), edge_columns, edge_columnTypes, mDb->sortsEdges() ? mDb->edgeClusterKey() : QStringList() );
         }
     }
 
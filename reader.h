@@ -17,9 +17,44 @@ public:
 
     void loadData();
 
+    /// Load this folder as another version of the corpus in @baseFolderPath.
+    /// Tables get a _<version> suffix; node tables keep only the rows that differ
+    /// from the base version, behind views that look like the full tables.
+    void setBaseVersion(const QString & baseFolderPath);
+
+    /// build full-text indexes over these string features after loading;
+    /// @tokenizer is backend-specific (empty for the default)
+    void setFullTextFeatures(const QStringList & features, const QString & tokenizer);
+
+    /// render the otext.tf formats for every node of these otypes after loading
+    void setOTextTypes(const QStringList & otypes);
+
+    /// build compressed bitmap indexes (see BitmapIndex) for these categorical features after loading
+    void setBitmapFeatures(const QStringList & features);
+
+    /// Import only part of the corpus. Each selector narrows the ones before it:
+    /// @ranges is a node range string like 1-28763,426585; @books are values of
+    /// book.tf, which select every node with a slot in those books; @otypes keeps
+    /// just those tables; @features keeps just those files.
+    void setNodeRanges(const QString & ranges);
+    void setBooks(const QStringList & books);
+    void setOtypes(const QStringList & otypes);
+    void setFeatures(const QStringList & features);
+
+    /// build the word_context table (see WordContext) with a column for each of these otypes
+    void setContextLevels(const QStringList & levels);
+
 private:
     void processOtypeFile();
+    void scanFiles();
     void createTables();
+    void resolveSelection();
+    NodeSelection bookSelection() const;
+
+    QString version() const;
+    void loadOmap();
+    void deduplicateAgainstBase();
+    void createFullTextIndexes();
 
     QStringList mFilesToSkip;
     QHash<QString,QPair<unsigned int,unsigned int>> mOTypeRanges;
@@ -28,6 +63,20 @@ private:
 
     AbstractDatabaseAdapter * mDb;
     QDir mFolder;
+    QDir mBaseFolder;
+    bool mIsVersion;
+
+    QStringList mFullTextFeatures;
+    QString mFullTextTokenizer;
+    QStringList mOTextTypes;
+    QStringList mBitmapFeatures;
+    QStringList mContextLevels;
+
+    QString mNodeRanges;
+    QStringList mBooks;
+    QStringList mSelectedOtypes;
+    QStringList mFeatures;
+    NodeSelection mSelection;
 };
 
 
@@ -0,0 +1,344 @@
+#include "roaringbitmap.h"
+
+#include <QDataStream>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+/// beyond this many entries a bitmap container is smaller than an array
+const int ArrayLimit = 4096;
+const int BitmapWords = 1024;
+}
+
+RoaringBitmap::Container::Container() :
+    isBitmap(false),
+    cardinality(0)
+{
+}
+
+void RoaringBitmap::Container::add(quint16 low)
+{
+    if( isBitmap ) {
+        quint64 & word = bits[low >> 6];
+        const quint64 mask = quint64(1) << (low & 63);
+        if( !(word & mask) ) {
+            word |= mask;
+            cardinality++;
+        }
+        return;
+    }
+
+    /// values nearly always arrive in ascending order
+    if( array.isEmpty() || low > array.last() ) {
+        array.append(low);
+    } else {
+        auto it = std::lower_bound(array.begin(), array.end(), low);
+        if( *it == low ) {
+            return;
+        }
+        array.insert(it, low);
+    }
+    cardinality++;
+    if( cardinality > ArrayLimit ) {
+        toBitmap();
+    }
+}
+
+bool RoaringBitmap::Container::contains(quint16 low) const
+{
+    if( isBitmap ) {
+        return bits.at(low >> 6) & (quint64(1) << (low & 63));
+    }
+    return std::binary_search(array.constBegin(), array.constEnd(), low);
+}
+
+void RoaringBitmap::Container::toBitmap()
+{
+    if( isBitmap ) {
+        return;
+    }
+    bits.fill(0, BitmapWords);
+    foreach( quint16 low, array ) {
+        bits[low >> 6] |= quint64(1) << (low & 63);
+    }
+    array.clear();
+    isBitmap = true;
+}
+
+void RoaringBitmap::Container::optimize()
+{
+    if( !isBitmap || cardinality > ArrayLimit ) {
+        return;
+    }
+    array.clear();
+    array.reserve(cardinality);
+    for(int w = 0; w < BitmapWords; w++) {
+        quint64 word = bits.at(w);
+        while( word ) {
+            const int bit = qCountTrailingZeroBits(word);
+            array.append( static_cast<quint16>(w * 64 + bit) );
+            word &= word - 1;
+        }
+    }
+    bits.clear();
+    isBitmap = false;
+}
+
+RoaringBitmap::RoaringBitmap()
+{
+}
+
+int RoaringBitmap::containerIndex(quint16 key) const
+{
+    auto it = std::lower_bound(mKeys.constBegin(), mKeys.constEnd(), key);
+    if( it == mKeys.constEnd() || *it != key ) {
+        return -1;
+    }
+    return static_cast<int>(it - mKeys.constBegin());
+}
+
+RoaringBitmap::Container &RoaringBitmap::containerFor(quint16 key)
+{
+    if( mKeys.isEmpty() || key > mKeys.last() ) {
+        mKeys.append(key);
+        mContainers.append(Container());
+        return mContainers.last();
+    }
+    auto it = std::lower_bound(mKeys.begin(), mKeys.end(), key);
+    const int index = static_cast<int>(it - mKeys.begin());
+    if( *it != key ) {
+        mKeys.insert(index, key);
+        mContainers.insert(index, Container());
+    }
+    return mContainers[index];
+}
+
+void RoaringBitmap::add(quint32 value)
+{
+    containerFor( static_cast<quint16>(value >> 16) ).add( static_cast<quint16>(value & 0xFFFF) );
+}
+
+bool RoaringBitmap::contains(quint32 value) const
+{
+    const int index = containerIndex( static_cast<quint16>(value >> 16) );
+    return index >= 0 && mContainers.at(index).contains( static_cast<quint16>(value & 0xFFFF) );
+}
+
+quint64 RoaringBitmap::cardinality() const
+{
+    quint64 total = 0;
+    foreach( const Container & c, mContainers ) {
+        total += static_cast<quint64>(c.cardinality);
+    }
+    return total;
+}
+
+bool RoaringBitmap::isEmpty() const
+{
+    return mContainers.isEmpty();
+}
+
+QVector<quint32> RoaringBitmap::toVector() const
+{
+    QVector<quint32> values;
+    values.reserve( static_cast<int>(cardinality()) );
+    for(int i = 0; i < mKeys.count(); i++) {
+        const quint32 high = static_cast<quint32>(mKeys.at(i)) << 16;
+        const Container & c = mContainers.at(i);
+        if( c.isBitmap ) {
+            for(int w = 0; w < BitmapWords; w++) {
+                quint64 word = c.bits.at(w);
+                while( word ) {
+                    values.append( high | static_cast<quint32>(w * 64 + qCountTrailingZeroBits(word)) );
+                    word &= word - 1;
+                }
+            }
+        } else {
+            foreach( quint16 low, c.array ) {
+                values.append( high | low );
+            }
+        }
+    }
+    return values;
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(const Container &a, const Container &b)
+{
+    Container result;
+    if( !a.isBitmap && !b.isBitmap ) {
+        std::set_intersection( a.array.constBegin(), a.array.constEnd(), b.array.constBegin(), b.array.constEnd(), std::back_inserter(result.array) );
+        result.cardinality = result.array.count();
+    } else if( a.isBitmap && b.isBitmap ) {
+        result.isBitmap = true;
+        result.bits.resize(BitmapWords);
+        for(int w = 0; w < BitmapWords; w++) {
+            result.bits[w] = a.bits.at(w) & b.bits.at(w);
+            result.cardinality += qPopulationCount( result.bits.at(w) );
+        }
+        result.optimize();
+    } else {
+        const Container & array = a.isBitmap ? b : a;
+        const Container & bitmap = a.isBitmap ? a : b;
+        foreach( quint16 low, array.array ) {
+            if( bitmap.contains(low) ) {
+                result.array.append(low);
+            }
+        }
+        result.cardinality = result.array.count();
+    }
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::unite(const Container &a, const Container &b)
+{
+    Container result;
+    if( !a.isBitmap && !b.isBitmap ) {
+        std::set_union( a.array.constBegin(), a.array.constEnd(), b.array.constBegin(), b.array.constEnd(), std::back_inserter(result.array) );
+        result.cardinality = result.array.count();
+        if( result.cardinality > ArrayLimit ) {
+            result.toBitmap();
+        }
+        return result;
+    }
+
+    result = a.isBitmap ? a : b;
+    const Container & other = a.isBitmap ? b : a;
+    if( other.isBitmap ) {
+        result.cardinality = 0;
+        for(int w = 0; w < BitmapWords; w++) {
+            result.bits[w] |= other.bits.at(w);
+            result.cardinality += qPopulationCount( result.bits.at(w) );
+        }
+    } else {
+        foreach( quint16 low, other.array ) {
+            result.add(low);
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::intersect(const RoaringBitmap &a, const RoaringBitmap &b)
+{
+    RoaringBitmap result;
+    int i = 0, j = 0;
+    while( i < a.mKeys.count() && j < b.mKeys.count() ) {
+        if( a.mKeys.at(i) < b.mKeys.at(j) ) {
+            i++;
+        } else if( a.mKeys.at(i) > b.mKeys.at(j) ) {
+            j++;
+        } else {
+            const Container c = intersect( a.mContainers.at(i), b.mContainers.at(j) );
+            if( c.cardinality > 0 ) {
+                result.mKeys.append( a.mKeys.at(i) );
+                result.mContainers.append(c);
+            }
+            i++;
+            j++;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::unite(const RoaringBitmap &a, const RoaringBitmap &b)
+{
+    RoaringBitmap result;
+    int i = 0, j = 0;
+    while( i < a.mKeys.count() || j < b.mKeys.count() ) {
+        if( j >= b.mKeys.count() || ( i < a.mKeys.count() && a.mKeys.at(i) < b.mKeys.at(j) ) ) {
+            result.mKeys.append( a.mKeys.at(i) );
+            result.mContainers.append( a.mContainers.at(i) );
+            i++;
+        } else if( i >= a.mKeys.count() || b.mKeys.at(j) < a.mKeys.at(i) ) {
+            result.mKeys.append( b.mKeys.at(j) );
+            result.mContainers.append( b.mContainers.at(j) );
+            j++;
+        } else {
+            result.mKeys.append( a.mKeys.at(i) );
+            result.mContainers.append( unite( a.mContainers.at(i), b.mContainers.at(j) ) );
+            i++;
+            j++;
+        }
+    }
+    return result;
+}
+
+QByteArray RoaringBitmap::serialize() const
+{
+    /// count, then for each container: key, type, cardinality, and the array or the 1024 words
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << static_cast<quint32>(mKeys.count());
+    for(int i = 0; i < mKeys.count(); i++) {
+        const Container & c = mContainers.at(i);
+        out << mKeys.at(i) << static_cast<quint8>(c.isBitmap ? 1 : 0) << static_cast<quint32>(c.cardinality);
+        if( c.isBitmap ) {
+            foreach( quint64 word, c.bits ) {
+                out << word;
+            }
+        } else {
+            foreach( quint16 low, c.array ) {
+                out << low;
+            }
+        }
+    }
+    return data;
+}
+
+RoaringBitmap RoaringBitmap::deserialize(const QByteArray &data)
+{
+    RoaringBitmap bitmap;
+    QDataStream in(data);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    /// nothing read from the blob is trusted: counts are checked before anything is
+    /// allocated from them, and anything malformed or cut short gives an empty bitmap
+    quint32 count = 0;
+    in >> count;
+    if( in.status() != QDataStream::Ok || count > 65536 ) {
+        return RoaringBitmap();
+    }
+    for(quint32 i = 0; i < count; i++) {
+        quint16 key;
+        quint8 type;
+        quint32 cardinality;
+        in >> key >> type >> cardinality;
+        if( in.status() != QDataStream::Ok || type > 1
+                || ( !bitmap.mKeys.isEmpty() && key <= bitmap.mKeys.last() ) ) {
+            return RoaringBitmap();
+        }
+
+        Container c;
+        c.isBitmap = type == 1;
+        if( c.isBitmap ) {
+            c.bits.resize(BitmapWords);
+            for(int w = 0; w < BitmapWords; w++) {
+                in >> c.bits[w];
+                c.cardinality += qPopulationCount( c.bits.at(w) );
+            }
+            if( static_cast<quint32>(c.cardinality) != cardinality ) {
+                return RoaringBitmap();
+            }
+        } else {
+            if( cardinality > static_cast<quint32>(ArrayLimit) ) {
+                return RoaringBitmap();
+            }
+            c.cardinality = static_cast<int>(cardinality);
+            c.array.resize( c.cardinality );
+            for(int k = 0; k < c.array.count(); k++) {
+                in >> c.array[k];
+                if( k > 0 && c.array.at(k) <= c.array.at(k-1) ) {
+                    return RoaringBitmap();
+                }
+            }
+        }
+        if( in.status() != QDataStream::Ok ) {
+            return RoaringBitmap();
+        }
+        bitmap.mKeys.append(key);
+        bitmap.mContainers.append(c);
+    }
+    return bitmap;
+}
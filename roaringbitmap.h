@@ -0,0 +1,59 @@
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <QByteArray>
+#include <QVector>
+
+/// A compressed set of node numbers in the style of Roaring bitmaps: numbers
+/// are grouped by their high 16 bits, and each group is stored as a sorted
+/// array of low halves while it is sparse (up to 4096 entries), or as a
+/// 65536-bit bitmap once it is dense.
+class RoaringBitmap
+{
+public:
+    RoaringBitmap();
+
+    void add(quint32 value);
+    bool contains(quint32 value) const;
+    quint64 cardinality() const;
+    bool isEmpty() const;
+
+    /// the members in ascending order
+    QVector<quint32> toVector() const;
+
+    static RoaringBitmap intersect(const RoaringBitmap & a, const RoaringBitmap & b);
+    static RoaringBitmap unite(const RoaringBitmap & a, const RoaringBitmap & b);
+
+    /// a compact binary form for storing in a BLOB column
+    QByteArray serialize() const;
+    /// an empty bitmap if @data is malformed or cut short
+    static RoaringBitmap deserialize(const QByteArray & data);
+
+private:
+    struct Container {
+        Container();
+        bool isBitmap;
+        int cardinality;
+        /// sorted low halves, used while !isBitmap
+        QVector<quint16> array;
+        /// 1024 words, used while isBitmap
+        QVector<quint64> bits;
+
+        void add(quint16 low);
+        bool contains(quint16 low) const;
+        void toBitmap();
+        void optimize();
+    };
+
+    int containerIndex(quint16 key) const;
+    Container & containerFor(quint16 key);
+
+    static Container intersect(const Container & a, const Container & b);
+    static Container unite(const Container & a, const Container & b);
+
+    /// sorted, and parallel to mContainers
+    QVector<quint16> mKeys;
+    QVector<Container> mContainers;
+};
+
+#endif // ROARINGBITMAP_H
@@ -1,17 +1,88 @@
 #include "sqlitedatabaseadapter.h"
 
 #include <QtSql>
+#include <QTemporaryFile>
 
-SqliteDatabaseAdapter::SqliteDatabaseAdapter(const QString & filename) : AbstractDatabaseAdapter(filename)
+#include "sqliteshardwriter.h"
+
+SqliteDatabaseAdapter::SqliteDatabaseAdapter(const QString & filename, bool inMemory, int pageSize, const QString & autoVacuum) : AbstractDatabaseAdapter(filename),
+    mInMemory(inMemory),
+    mPageSize(pageSize),
+    mAutoVacuum(autoVacuum),
+    mHasFreePages(false),
+    mUseShards(false),
+    mSharding(false)
 {
+    /// SQLite is happiest with large batches, but very large transactions spill the page cache
+    setBatchDefaults(50000, 1000000);
+
     QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", mConnectionName);
-    db.setDatabaseName(mConnectionName);
+    db.setDatabaseName( mInMemory ? QString(":memory:") : mConnectionName );
     db.setHostName("hostname");
     if(!db.open())
     {
         qCritical() << "There was a problem in opening the database. The program said: " + db.lastError().databaseText();
         return;
     }
+    /// these only take effect before the first table is created (or on VACUUM)
+    if( mPageSize > 0 ) {
+        db.exec("PRAGMA PAGE_SIZE = " + QString::number(mPageSize) + ";");
+    }
+    if( !mAutoVacuum.isEmpty() ) {
+        db.exec("PRAGMA AUTO_VACUUM = " + mAutoVacuum.toUpper() + ";");
+    }
+    configureConnection(db);
+}
+
+bool SqliteDatabaseAdapter::finishImport()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if( mInMemory ) {
+        /// VACUUM INTO writes a compact copy in one pass, but only into a missing or empty
+        /// file; it goes next to the target first, so a failure leaves the old file alone
+        QTemporaryFile copy( mConnectionName + ".XXXXXX" );
+        if( !copy.open() ) {
+            qCritical() << "SqliteDatabaseAdapter::finishImport" << "Could not create" << copy.fileName() << copy.errorString();
+            return false;
+        }
+        copy.close();
+        QString path = copy.fileName();
+        path.replace("'", "''");
+        if( !execQuery( "VACUUM INTO '" + path + "';", "SqliteDatabaseAdapter::finishImport" ) ) {
+            return false;
+        }
+        if( QFile::exists(mConnectionName) && !QFile::remove(mConnectionName) ) {
+            qCritical() << "SqliteDatabaseAdapter::finishImport" << "Could not replace" << mConnectionName;
+            return false;
+        }
+        if( !QFile::rename( copy.fileName(), mConnectionName ) ) {
+            /// the database is complete, just under the wrong name
+            copy.setAutoRemove(false);
+            qCritical() << "SqliteDatabaseAdapter::finishImport" << "Could not rename" << copy.fileName() << "to" << mConnectionName;
+            return false;
+        }
+        copy.setAutoRemove(false);
+        qInfo().noquote() << "Wrote" << mConnectionName << "in" << timer.elapsed() << "milliseconds";
+    } else if( mPageSize > 0 || !mAutoVacuum.isEmpty() || mHasFreePages ) {
+        /// an existing file only picks up a new page size or auto-vacuum mode when it is
+        /// rebuilt, and only gives back the pages of deleted rows then too
+        if( !execQuery( "VACUUM;", "SqliteDatabaseAdapter::finishImport" ) ) {
+            return false;
+        }
+        qDebug() << "Vacuumed in" << timer.elapsed() << "milliseconds";
+    }
+    return true;
+}
+
+SqliteDatabaseAdapter::~SqliteDatabaseAdapter()
+{
+    qDeleteAll(mShards);
+}
+
+void SqliteDatabaseAdapter::configureConnection(QSqlDatabase db)
+{
     db.exec("PRAGMA TEMP_STORE = MEMORY;");
     db.exec("PRAGMA JOURNAL_MODE = OFF;");
     db.exec("PRAGMA SYNCHRONOUS = OFF;");
@@ -19,8 +90,147 @@ SqliteDatabaseAdapter::SqliteDatabaseAdapter(const QString & filename) : Abstrac
     db.exec("PRAGMA encoding=\"UTF-8\";");
 }
 
-SqliteDatabaseAdapter::~SqliteDatabaseAdapter()
+void SqliteDatabaseAdapter::setUseShards(bool useShards)
 {
+    mUseShards = useShards;
+}
+
+bool SqliteDatabaseAdapter::writesInBackground() const
+{
+    return mSharding;
+}
+
+void SqliteDatabaseAdapter::beginLoading()
+{
+    if( !mUseShards ) {
+        return;
+    }
+    /// keep the shards on the same disk as the target
+    mShardFolder.reset( new QTemporaryDir( QFileInfo(mConnectionName).absolutePath() + "/textfabric2sql-shards-XXXXXX" ) );
+    if( !mShardFolder->isValid() ) {
+        qWarning() << "SqliteDatabaseAdapter::beginLoading" << "Could not create a folder for the shards; writing directly instead.";
+        mShardFolder.reset();
+        return;
+    }
+    mSharding = true;
+}
+
+void SqliteDatabaseAdapter::finishLoading()
+{
+    if( !mSharding ) {
+        return;
+    }
+    mSharding = false;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    /// let every writer drain its queue; they carry on in parallel while we wait for each
+    foreach( SqliteShardWriter * shard, mShards ) {
+        shard->finish();
+    }
+    qDebug() << "Shard writers finished in" << timer.elapsed() << "milliseconds";
+
+    /// ATTACH isn't allowed inside a transaction
+    commitTransaction();
+    QHashIterator<QString,SqliteShardWriter*> i(mShards);
+    while( i.hasNext() ) {
+        i.next();
+        mergeShard( i.key(), i.value() );
+    }
+    qDeleteAll(mShards);
+    mShards.clear();
+    mShardFolder.reset();
+    beginTransaction();
+
+    qDebug() << "Merged shards in" << timer.elapsed() << "milliseconds";
+}
+
+void SqliteDatabaseAdapter::mergeShard(const QString &table, SqliteShardWriter *shard)
+{
+    QSqlDatabase db = QSqlDatabase::database(mConnectionName);
+    QString path = shard->filename();
+    path.replace("'", "''");
+    if( !execQuery( "ATTACH DATABASE '" + path + "' AS shard;", "SqliteDatabaseAdapter::mergeShard" ) ) {
+        return;
+    }
+
+    QSqlQuery q(db);
+    QString ddl;
+    if( q.exec("SELECT sql FROM shard.sqlite_master WHERE type='table' AND name='" + QString(table).replace("'", "''") + "';") && q.next() ) {
+        ddl = q.value(0).toString();
+    }
+    q.finish();
+
+    if( ddl.isEmpty() ) {
+        qWarning() << "SqliteDatabaseAdapter::mergeShard" << "No table in shard:" << table;
+    } else {
+        QStringList indexes;
+        if( q.exec("SELECT sql FROM shard.sqlite_master WHERE type='index' AND sql IS NOT NULL AND tbl_name='" + QString(table).replace("'", "''") + "';") ) {
+            while( q.next() ) {
+                indexes << q.value(0).toString();
+            }
+        }
+        q.finish();
+
+        /// with identical definitions and no indexes, SQLite copies the records across without
+        /// decoding them; the shard's indexes are built afterwards, in one pass each
+        db.transaction();
+        execQuery( "DROP TABLE IF EXISTS main.`" + table + "`;", "SqliteDatabaseAdapter::mergeShard" );
+        execQuery( ddl, "SqliteDatabaseAdapter::mergeShard" );
+        execQuery( "INSERT INTO main.`" + table + "` SELECT * FROM shard.`" + table + "`;", "SqliteDatabaseAdapter::mergeShard" );
+        foreach( QString index, indexes ) {
+            execQuery( index, "SqliteDatabaseAdapter::mergeShard" );
+        }
+        db.commit();
+    }
+
+    execQuery( "DETACH DATABASE shard;", "SqliteDatabaseAdapter::mergeShard" );
+    QFile::remove( shard->filename() );
+}
+
+SqliteShardWriter *SqliteDatabaseAdapter::shardFor(const QString &table)
+{
+    SqliteShardWriter * shard = mShards.value(table, nullptr);
+    if( shard == nullptr ) {
+        shard = new SqliteShardWriter( mShardFolder->filePath( QString("shard%1.sqlite").arg(mShards.count()) ), commitSize() );
+        mShards.insert(table, shard);
+        shard->start();
+    }
+    return shard;
+}
+
+bool SqliteDatabaseAdapter::execBatched(const QString &table, const QString &queryString, const QStringList &placeholders, const QList<QVariantList> &columns)
+{
+    if( !mSharding ) {
+        return AbstractDatabaseAdapter::execBatched(table, queryString, placeholders, columns);
+    }
+
+    SqliteShardWriter * shard = shardFor(table);
+    const int rowCount = columns.first().count();
+    for(int offset = 0; offset < rowCount; offset += batchSize()) {
+        QList<QVariantList> chunk;
+        for(int i=0; i<columns.count(); i++) {
+            chunk << columns.at(i).mid(offset, batchSize());
+        }
+        shard->enqueueBatch(queryString, placeholders, chunk);
+    }
+    return true;
+}
+
+void SqliteDatabaseAdapter::tableShrunk(const QString &table)
+{
+    Q_UNUSED(table)
+    mHasFreePages = true;
+}
+
+bool SqliteDatabaseAdapter::execStatement(const QString &table, const QString &query)
+{
+    if( !mSharding ) {
+        return AbstractDatabaseAdapter::execStatement(table, query);
+    }
+    shardFor(table)->enqueueStatement(query);
+    return true;
 }
 
 QString SqliteDatabaseAdapter::insertNodeDataQueryString(const QString &table, const QString &column) const
@@ -58,9 +268,31 @@ QString SqliteDatabaseAdapter::addTableColumnQueryString(const QString &table, c
     return "ALTER TABLE `" + table + "` ADD \"" + column + "\" "+columnType+";";
 }
 
-QString SqliteDatabaseAdapter::createOTypeTableQueryString() const
+QString SqliteDatabaseAdapter::createOTypeTableQueryString(const QString &table) const
+{
+    return "INSERT INTO `"+table+"` (startNode, endNode, typeLabel) VALUES (:startNode,:endNode,:typeLabel);";
+}
+
+QString SqliteDatabaseAdapter::dropViewQueryString(const QString &view) const
+{
+    return "DROP VIEW IF EXISTS `" + view + "`;";
+}
+
+QString SqliteDatabaseAdapter::nullSafeEqualsString(const QString &left, const QString &right) const
 {
-    return "INSERT INTO otype (startNode, endNode, typeLabel) VALUES (:startNode,:endNode,:typeLabel);";
+    return left + " IS " + right;
+}
+
+QStringList SqliteDatabaseAdapter::createFullTextIndexQueryStrings(const QString &table, const QStringList &columns, const QString &tokenizer) const
+{
+    /// an external-content table: the text stays in the node table and only the index is stored
+    const QString fts = table + "_fts";
+    const QString tokenize = tokenizer.isEmpty() ? QString("unicode61 remove_diacritics 0") : tokenizer;
+    QStringList queries;
+    queries << "DROP TABLE IF EXISTS `" + fts + "`;";
+    queries << "CREATE VIRTUAL TABLE `" + fts + "` USING fts5(" + columns.join(", ") + ", content='" + table + "', content_rowid='_id', tokenize='" + QString(tokenize).replace("'", "''") + "');";
+    queries << "INSERT INTO `" + fts + "`(`" + fts + "`) VALUES('rebuild');";
+    return queries;
 }
 
 QString SqliteDatabaseAdapter::integerType() const
@@ -72,3 +304,20 @@ QString SqliteDatabaseAdapter::stringType() const
 {
     return "text";
 }
+
+QString SqliteDatabaseAdapter::longTextType() const
+{
+    return "text";
+}
+
+QString SqliteDatabaseAdapter::blobType() const
+{
+    return "blob";
+}
+
+QString SqliteDatabaseAdapter::primaryKeyType() const
+{
+    /// only this exact spelling makes the column an alias for the rowid, so that
+    /// the table B-tree itself is keyed on it and no separate index is needed
+    return "INTEGER PRIMARY KEY";
+}
@@ -3,9 +3,18 @@
 
 #include "abstractdatabaseadapter.h"
 
+#include <QSqlDatabase>
+#include <QTemporaryDir>
+#include <QScopedPointer>
+
+class SqliteShardWriter;
+
 class SqliteDatabaseAdapter : public AbstractDatabaseAdapter {
 public:
-    explicit SqliteDatabaseAdapter(const QString & filename);
+    /// With @inMemory, the database is built in memory and written to @filename
+    /// in one sequential pass by finishImport. @pageSize (in bytes) and
+    /// @autoVacuum (none, full or incremental) are left alone if empty.
+    explicit SqliteDatabaseAdapter(const QString & filename, bool inMemory = false, int pageSize = 0, const QString & autoVacuum = QString());
     ~SqliteDatabaseAdapter() override;
 
     QString insertNodeDataQueryString(const QString &table, const QString &column) const override;
@@ -13,10 +22,48 @@ public:
     QString createTableQueryString(const QString &table, const QSet<QString> &columns, const QHash<QString, QString> &columnTypes) const override;
     QString dropTableQueryString(const QString &table) const override;
     QString addTableColumnQueryString(const QString &table, const QString &column, const QString &columnType) const override;
-    QString createOTypeTableQueryString() const override;
+    QString createOTypeTableQueryString(const QString &table) const override;
+    QString dropViewQueryString(const QString &view) const override;
+    QString nullSafeEqualsString(const QString &left, const QString &right) const override;
+    QStringList createFullTextIndexQueryStrings(const QString &table, const QStringList &columns, const QString &tokenizer) const override;
 
     QString integerType() const override;
     QString stringType() const override;
+    QString longTextType() const override;
+    QString blobType() const override;
+    QString primaryKeyType() const override;
+
+    /// write each table into its own temporary file from its own thread while
+    /// loading, and merge them into the target in finishLoading
+    void setUseShards(bool useShards);
+    bool writesInBackground() const override;
+
+    void beginLoading() override;
+    void finishLoading() override;
+    bool finishImport() override;
+
+    /// the PRAGMAs used for every connection we write through
+    static void configureConnection(QSqlDatabase db);
+
+protected:
+    bool execBatched(const QString &table, const QString &queryString, const QStringList &placeholders, const QList<QVariantList> &columns) override;
+    bool execStatement(const QString &table, const QString &query) override;
+    void tableShrunk(const QString &table) override;
+
+private:
+    SqliteShardWriter * shardFor(const QString &table);
+    void mergeShard(const QString &table, SqliteShardWriter * shard);
+
+    bool mInMemory;
+    int mPageSize;
+    QString mAutoVacuum;
+    /// deleted rows leave free pages in the file until it is vacuumed
+    bool mHasFreePages;
+
+    bool mUseShards;
+    bool mSharding;
+    QScopedPointer<QTemporaryDir> mShardFolder;
+    QHash<QString,SqliteShardWriter*> mShards;
 };
 
 #endif // DATABASEADAPTER_H
@@ -0,0 +1,124 @@
+#include "sqliteshardwriter.h"
+
+#include <QtSql>
+
+#include "sqlitedatabaseadapter.h"
+
+namespace {
+/// enough to keep the writer busy while the loading thread parses the next file
+const int MaximumQueuedJobs = 8;
+}
+
+SqliteShardWriter::SqliteShardWriter(const QString & filename, int commitSize) :
+    mFilename(filename),
+    mCommitSize(commitSize)
+{
+}
+
+SqliteShardWriter::~SqliteShardWriter()
+{
+    if( isRunning() ) {
+        finish();
+    }
+}
+
+QString SqliteShardWriter::filename() const
+{
+    return mFilename;
+}
+
+void SqliteShardWriter::enqueueStatement(const QString &query)
+{
+    Job job;
+    job.query = query;
+    job.stop = false;
+    enqueue(job);
+}
+
+void SqliteShardWriter::enqueueBatch(const QString &query, const QStringList &placeholders, const QList<QVariantList> &columns)
+{
+    Job job;
+    job.query = query;
+    job.placeholders = placeholders;
+    job.columns = columns;
+    job.stop = false;
+    enqueue(job);
+}
+
+void SqliteShardWriter::finish()
+{
+    Job job;
+    job.stop = true;
+    enqueue(job);
+    wait();
+}
+
+void SqliteShardWriter::enqueue(const Job &job)
+{
+    QMutexLocker locker(&mMutex);
+    while( mJobs.count() >= MaximumQueuedJobs ) {
+        mNotFull.wait(&mMutex);
+    }
+    mJobs.enqueue(job);
+    mNotEmpty.wakeOne();
+}
+
+void SqliteShardWriter::run()
+{
+    /// the connection has to be created in the thread that uses it
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", mFilename);
+        db.setDatabaseName(mFilename);
+        if( !db.open() ) {
+            qCritical() << "SqliteShardWriter::run" << db.lastError().databaseText() << mFilename;
+        }
+        SqliteDatabaseAdapter::configureConnection(db);
+        db.transaction();
+
+        qint64 rowsSinceCommit = 0;
+        forever {
+            Job job;
+            {
+                QMutexLocker locker(&mMutex);
+                while( mJobs.isEmpty() ) {
+                    mNotEmpty.wait(&mMutex);
+                }
+                job = mJobs.dequeue();
+                mNotFull.wakeOne();
+            }
+            if( job.stop ) {
+                break;
+            }
+
+            QSqlQuery q(db);
+            if( job.columns.isEmpty() ) {
+                if( !q.exec(job.query) ) {
+                    qWarning() << "SqliteShardWriter::run" << q.lastError().text() << job.query;
+                }
+                continue;
+            }
+
+            if( !q.prepare(job.query) ) {
+                qWarning() << "SqliteShardWriter::run" << q.lastError().text() << job.query;
+                continue;
+            }
+            for(int i=0; i<job.columns.count(); i++) {
+                q.bindValue(job.placeholders.at(i), job.columns.at(i));
+            }
+            if( !q.execBatch() ) {
+                qWarning() << "SqliteShardWriter::run" << q.lastError().text() << q.executedQuery();
+            }
+
+            rowsSinceCommit += job.columns.first().count();
+            if( rowsSinceCommit >= mCommitSize ) {
+                db.commit();
+                db.transaction();
+                rowsSinceCommit = 0;
+            }
+        }
+
+        db.commit();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(mFilename);
+}
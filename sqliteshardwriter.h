@@ -0,0 +1,51 @@
+#ifndef SQLITESHARDWRITER_H
+#define SQLITESHARDWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVariantList>
+#include <QStringList>
+
+/// Writes one table into its own SQLite file from its own thread, so that
+/// several tables can be written at once. Statements are queued by the
+/// loading thread and executed in order; the queue is bounded, so a producer
+/// that gets ahead of the writer waits for it.
+class SqliteShardWriter : public QThread
+{
+public:
+    SqliteShardWriter(const QString & filename, int commitSize);
+    ~SqliteShardWriter() override;
+
+    QString filename() const;
+
+    void enqueueStatement(const QString & query);
+    void enqueueBatch(const QString & query, const QStringList & placeholders, const QList<QVariantList> & columns);
+
+    /// execute everything that is queued, commit, and stop the thread
+    void finish();
+
+protected:
+    void run() override;
+
+private:
+    struct Job {
+        QString query;
+        QStringList placeholders;
+        QList<QVariantList> columns;
+        bool stop;
+    };
+
+    void enqueue(const Job & job);
+
+    QString mFilename;
+    int mCommitSize;
+
+    QMutex mMutex;
+    QWaitCondition mNotEmpty;
+    QWaitCondition mNotFull;
+    QQueue<Job> mJobs;
+};
+
+#endif // SQLITESHARDWRITER_H
@@ -0,0 +1,191 @@
+#include <QtTest>
+
+#include <algorithm>
+
+#include "externaledgesorter.h"
+
+/// one edge as the sorter hands it on
+struct SortedEdge {
+    unsigned int from;
+    unsigned int to;
+    QVariant value;
+};
+
+class TestExternalEdgeSorter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void inMemory();
+    void spillsAndMerges_data();
+    void spillsAndMerges();
+    void keepsDuplicates();
+    void valueTypesSurvive();
+    void batches();
+
+private:
+    /// a fixed pseudo-random set of edges, with repeats and mixed value types
+    static QList<SortedEdge> edges(int count);
+    static QList<SortedEdge> sort(QList<SortedEdge> input, ExternalEdgeSorter::SortKey key, qint64 memoryBytes, int * runs = nullptr, int batchRows = 1000);
+    /// a strict weak order the sorter's output must follow
+    static bool lessThan(const SortedEdge & a, const SortedEdge & b, ExternalEdgeSorter::SortKey key);
+    static QString describe(const QList<SortedEdge> & edges);
+};
+
+QList<SortedEdge> TestExternalEdgeSorter::edges(int count)
+{
+    QList<SortedEdge> result;
+    quint32 state = 12345;
+    for(int i = 0; i < count; i++) {
+        state = state * 1103515245u + 12345u;
+        SortedEdge edge;
+        edge.from = (state >> 8) % 50;
+        edge.to = (state >> 16) % 50;
+        switch( (state >> 4) % 3 ) {
+        case 0: edge.value = QVariant(); break;
+        case 1: edge.value = QVariant( qlonglong( (state >> 20) % 5 ) ); break;
+        default: edge.value = QVariant( QString("v%1").arg( (state >> 24) % 5 ) ); break;
+        }
+        result << edge;
+    }
+    return result;
+}
+
+QList<SortedEdge> TestExternalEdgeSorter::sort(QList<SortedEdge> input, ExternalEdgeSorter::SortKey key, qint64 memoryBytes, int *runs, int batchRows)
+{
+    ExternalEdgeSorter sorter(key, memoryBytes);
+    foreach( const SortedEdge & edge, input ) {
+        sorter.add(edge.from, edge.to, edge.value);
+    }
+    if( runs != nullptr ) {
+        *runs = sorter.runCount();
+    }
+    QList<SortedEdge> output;
+    sorter.finish( [&](const QVariantList & froms, const QVariantList & tos, const QVariantList & values) {
+        QVERIFY( froms.count() <= batchRows );
+        for(int i = 0; i < froms.count(); i++) {
+            SortedEdge edge;
+            edge.from = froms.at(i).toUInt();
+            edge.to = tos.at(i).toUInt();
+            edge.value = values.at(i);
+            output << edge;
+        }
+    }, batchRows );
+    return output;
+}
+
+bool TestExternalEdgeSorter::lessThan(const SortedEdge &a, const SortedEdge &b, ExternalEdgeSorter::SortKey key)
+{
+    const unsigned int aFirst = key == ExternalEdgeSorter::SortByFrom ? a.from : a.to;
+    const unsigned int bFirst = key == ExternalEdgeSorter::SortByFrom ? b.from : b.to;
+    if( aFirst != bFirst ) {
+        return aFirst < bFirst;
+    }
+    const unsigned int aSecond = key == ExternalEdgeSorter::SortByFrom ? a.to : a.from;
+    const unsigned int bSecond = key == ExternalEdgeSorter::SortByFrom ? b.to : b.from;
+    if( aSecond != bSecond ) {
+        return aSecond < bSecond;
+    }
+    /// nulls, then integers, then strings
+    auto rank = [](const QVariant & v) { return v.isNull() ? 0 : ( v.type() == QVariant::LongLong ? 1 : 2 ); };
+    if( rank(a.value) != rank(b.value) ) {
+        return rank(a.value) < rank(b.value);
+    }
+    if( rank(a.value) == 1 ) {
+        return a.value.toLongLong() < b.value.toLongLong();
+    }
+    return a.value.toString() < b.value.toString();
+}
+
+QString TestExternalEdgeSorter::describe(const QList<SortedEdge> &edges)
+{
+    QStringList lines;
+    foreach( const SortedEdge & edge, edges ) {
+        lines << QString("%1 %2 %3 %4").arg(edge.from).arg(edge.to).arg( edge.value.isNull() ? "null" : edge.value.typeName() ).arg( edge.value.toString() );
+    }
+    return lines.join("\n");
+}
+
+void TestExternalEdgeSorter::inMemory()
+{
+    const QList<SortedEdge> input = edges(500);
+    int runs = -1;
+    const QList<SortedEdge> output = sort( input, ExternalEdgeSorter::SortByFrom, 64 * 1024 * 1024, &runs );
+    QCOMPARE( runs, 0 );
+
+    QList<SortedEdge> expected = input;
+    std::stable_sort( expected.begin(), expected.end(), [](const SortedEdge & a, const SortedEdge & b) { return lessThan(a, b, ExternalEdgeSorter::SortByFrom); } );
+    QCOMPARE( describe(output), describe(expected) );
+}
+
+void TestExternalEdgeSorter::spillsAndMerges_data()
+{
+    QTest::addColumn<int>("key");
+    QTest::newRow("from") << static_cast<int>(ExternalEdgeSorter::SortByFrom);
+    QTest::newRow("to") << static_cast<int>(ExternalEdgeSorter::SortByTo);
+}
+
+void TestExternalEdgeSorter::spillsAndMerges()
+{
+    QFETCH(int, key);
+    const ExternalEdgeSorter::SortKey sortKey = static_cast<ExternalEdgeSorter::SortKey>(key);
+
+    /// a budget of a few kilobytes forces many runs
+    const QList<SortedEdge> input = edges(2000);
+    int runs = 0;
+    const QList<SortedEdge> output = sort( input, sortKey, 4096, &runs );
+    QVERIFY( runs > 1 );
+
+    QList<SortedEdge> expected = input;
+    std::stable_sort( expected.begin(), expected.end(), [&](const SortedEdge & a, const SortedEdge & b) { return lessThan(a, b, sortKey); } );
+    QCOMPARE( output.count(), input.count() );
+    QCOMPARE( describe(output), describe(expected) );
+}
+
+void TestExternalEdgeSorter::keepsDuplicates()
+{
+    QList<SortedEdge> input;
+    for(int i = 0; i < 3; i++) {
+        input << SortedEdge{ 2, 1, QVariant( QString("x") ) } << SortedEdge{ 1, 1, QVariant( qlonglong(4) ) };
+    }
+    /// both in memory and through runs on disk
+    foreach( qint64 memory, QList<qint64>() << 64 * 1024 * 1024 << 1 ) {
+        const QList<SortedEdge> output = sort( input, ExternalEdgeSorter::SortByFrom, memory );
+        QCOMPARE( output.count(), 6 );
+        for(int i = 0; i < 3; i++) {
+            QCOMPARE( output.at(i).from, 1u );
+            QCOMPARE( output.at(i).value.toLongLong(), Q_INT64_C(4) );
+            QCOMPARE( output.at(i + 3).from, 2u );
+            QCOMPARE( output.at(i + 3).value.toString(), QString("x") );
+        }
+    }
+}
+
+void TestExternalEdgeSorter::valueTypesSurvive()
+{
+    QList<SortedEdge> input;
+    input << SortedEdge{ 1, 2, QVariant( QString("") ) }
+          << SortedEdge{ 1, 2, QVariant() }
+          << SortedEdge{ 1, 2, QVariant( qlonglong(10) ) }
+          << SortedEdge{ 1, 2, QVariant( qlonglong(9) ) };
+    /// a spill writes every value to disk and reads it back
+    const QList<SortedEdge> output = sort( input, ExternalEdgeSorter::SortByFrom, 1 );
+    QCOMPARE( output.count(), 4 );
+    QVERIFY( output.at(0).value.isNull() );
+    QCOMPARE( output.at(1).value.type(), QVariant::LongLong );
+    QCOMPARE( output.at(1).value.toLongLong(), Q_INT64_C(9) );
+    QCOMPARE( output.at(2).value.toLongLong(), Q_INT64_C(10) );
+    QCOMPARE( output.at(3).value.type(), QVariant::String );
+    QVERIFY( !output.at(3).value.isNull() );
+}
+
+void TestExternalEdgeSorter::batches()
+{
+    const QList<SortedEdge> input = edges(1000);
+    const QList<SortedEdge> output = sort( input, ExternalEdgeSorter::SortByTo, 4096, nullptr, 7 );
+    QCOMPARE( output.count(), input.count() );
+}
+
+QTEST_GUILESS_MAIN(TestExternalEdgeSorter)
+
+#include "tst_externaledgesorter.moc"
@@ -0,0 +1,48 @@
+#include <QtTest>
+
+#include "mysqldumpadapter.h"
+
+class TestMySqlDumpAdapter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void literal_data();
+    void literal();
+};
+
+void TestMySqlDumpAdapter::literal_data()
+{
+    QTest::addColumn<QVariant>("value");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("null") << QVariant() << QByteArray("NULL");
+    QTest::newRow("int") << QVariant(42) << QByteArray("42");
+    QTest::newRow("negative") << QVariant( qlonglong(-7) ) << QByteArray("-7");
+    QTest::newRow("unsigned") << QVariant( 4000000000u ) << QByteArray("4000000000");
+    QTest::newRow("largest") << QVariant( Q_UINT64_C(18446744073709551615) ) << QByteArray("18446744073709551615");
+
+    QTest::newRow("empty string") << QVariant( QString("") ) << QByteArray("''");
+    QTest::newRow("plain") << QVariant( QString("verb") ) << QByteArray("'verb'");
+    QTest::newRow("digits as text") << QVariant( QString("007") ) << QByteArray("'007'");
+    QTest::newRow("quotes") << QVariant( QString("O'Reilly said \"no\"") ) << QByteArray("'O\\'Reilly said \\\"no\\\"'");
+    QTest::newRow("backslash") << QVariant( QString("a\\b") ) << QByteArray("'a\\\\b'");
+    QTest::newRow("control characters") << QVariant( QString("a\nb\rc") + QChar(0) + "d" + QChar(0x1a) )
+                                        << QByteArray("'a\\nb\\rc\\0d\\Z'");
+    QTest::newRow("tab is left alone") << QVariant( QString("a\tb") ) << QByteArray("'a\tb'");
+    QTest::newRow("utf-8") << QVariant( QString::fromUtf8("\xd7\x91\xd6\xbc\xd6\xb0") ) << QByteArray("'\xd7\x91\xd6\xbc\xd6\xb0'");
+
+    QTest::newRow("blob") << QVariant( QByteArray("\x00\x01\xff", 3) ) << QByteArray("0x0001ff");
+    QTest::newRow("empty blob") << QVariant( QByteArray("") ) << QByteArray("''");
+}
+
+void TestMySqlDumpAdapter::literal()
+{
+    QFETCH(QVariant, value);
+    QFETCH(QByteArray, expected);
+    QCOMPARE( MySqlDumpAdapter::literal(value), expected );
+}
+
+QTEST_GUILESS_MAIN(TestMySqlDumpAdapter)
+
+#include "tst_mysqldumpadapter.moc"
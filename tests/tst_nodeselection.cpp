@@ -0,0 +1,112 @@
+#include <QtTest>
+
+#include "nodeselection.h"
+
+typedef NodeSelection::Interval Interval;
+typedef NodeSelection::Intervals Intervals;
+
+class TestNodeSelection : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void normalized_data();
+    void normalized();
+    void clip_data();
+    void clip();
+    void everything();
+    void containsAndIsPast();
+    void intersected();
+};
+
+void TestNodeSelection::normalized_data()
+{
+    QTest::addColumn<Intervals>("input");
+    QTest::addColumn<Intervals>("expected");
+
+    QTest::newRow("empty") << Intervals() << Intervals();
+    QTest::newRow("single") << ( Intervals() << Interval(5, 5) ) << ( Intervals() << Interval(5, 5) );
+    QTest::newRow("unsorted") << ( Intervals() << Interval(10, 12) << Interval(1, 3) ) << ( Intervals() << Interval(1, 3) << Interval(10, 12) );
+    QTest::newRow("overlapping") << ( Intervals() << Interval(1, 5) << Interval(2, 7) ) << ( Intervals() << Interval(1, 7) );
+    QTest::newRow("adjacent") << ( Intervals() << Interval(1, 3) << Interval(4, 6) ) << ( Intervals() << Interval(1, 6) );
+    QTest::newRow("contained") << ( Intervals() << Interval(1, 10) << Interval(3, 4) ) << ( Intervals() << Interval(1, 10) );
+    QTest::newRow("gap of one") << ( Intervals() << Interval(1, 3) << Interval(5, 6) ) << ( Intervals() << Interval(1, 3) << Interval(5, 6) );
+    /// the +1 for adjacency must not wrap around
+    QTest::newRow("at the top") << ( Intervals() << Interval(0xFFFFFFF0u, 0xFFFFFFFFu) << Interval(0, 1) )
+                                << ( Intervals() << Interval(0, 1) << Interval(0xFFFFFFF0u, 0xFFFFFFFFu) );
+}
+
+void TestNodeSelection::normalized()
+{
+    QFETCH(Intervals, input);
+    QFETCH(Intervals, expected);
+    QCOMPARE( NodeSelection::normalized(input), expected );
+}
+
+void TestNodeSelection::clip_data()
+{
+    QTest::addColumn<Intervals>("selection");
+    QTest::addColumn<Intervals>("input");
+    QTest::addColumn<Intervals>("expected");
+
+    const Intervals selection = Intervals() << Interval(10, 20) << Interval(30, 40);
+    QTest::newRow("inside") << selection << ( Intervals() << Interval(12, 15) ) << ( Intervals() << Interval(12, 15) );
+    QTest::newRow("outside") << selection << ( Intervals() << Interval(1, 9) << Interval(21, 29) << Interval(41, 50) ) << Intervals();
+    QTest::newRow("straddling") << selection << ( Intervals() << Interval(5, 12) ) << ( Intervals() << Interval(10, 12) );
+    QTest::newRow("spanning both") << selection << ( Intervals() << Interval(1, 100) ) << ( Intervals() << Interval(10, 20) << Interval(30, 40) );
+    QTest::newRow("several inputs") << selection << ( Intervals() << Interval(15, 16) << Interval(19, 31) << Interval(40, 45) )
+                                    << ( Intervals() << Interval(15, 16) << Interval(19, 20) << Interval(30, 31) << Interval(40, 40) );
+    QTest::newRow("single nodes") << selection << ( Intervals() << Interval(10, 10) << Interval(25, 25) << Interval(40, 40) )
+                                  << ( Intervals() << Interval(10, 10) << Interval(40, 40) );
+}
+
+void TestNodeSelection::clip()
+{
+    QFETCH(Intervals, selection);
+    QFETCH(Intervals, input);
+    QFETCH(Intervals, expected);
+    QCOMPARE( NodeSelection(selection).clip(input), expected );
+}
+
+void TestNodeSelection::everything()
+{
+    const NodeSelection all;
+    QVERIFY( all.isEverything() );
+    QVERIFY( all.contains(0) );
+    QVERIFY( all.contains(0xFFFFFFFFu) );
+    QVERIFY( !all.isPast(0xFFFFFFFFu) );
+    const Intervals input = Intervals() << Interval(3, 1000) << Interval(2000, 2000);
+    QCOMPARE( all.clip(input), input );
+}
+
+void TestNodeSelection::containsAndIsPast()
+{
+    /// unsorted and overlapping on the way in
+    const NodeSelection selection( Intervals() << Interval(30, 40) << Interval(10, 20) << Interval(15, 25) );
+    QVERIFY( !selection.isEverything() );
+    QCOMPARE( selection.intervals(), Intervals() << Interval(10, 25) << Interval(30, 40) );
+    QCOMPARE( selection.last(), 40u );
+
+    QVERIFY( !selection.contains(9) );
+    QVERIFY( selection.contains(10) );
+    QVERIFY( selection.contains(25) );
+    QVERIFY( !selection.contains(26) );
+    QVERIFY( selection.contains(40) );
+    QVERIFY( !selection.contains(41) );
+
+    QVERIFY( !selection.isPast(40) );
+    QVERIFY( selection.isPast(41) );
+}
+
+void TestNodeSelection::intersected()
+{
+    const NodeSelection a( Intervals() << Interval(1, 10) << Interval(20, 30) );
+    const NodeSelection b( Intervals() << Interval(5, 25) );
+    QCOMPARE( a.intersected(b).intervals(), Intervals() << Interval(5, 10) << Interval(20, 25) );
+    QCOMPARE( a.intersected( NodeSelection() ).intervals(), a.intervals() );
+    QCOMPARE( NodeSelection().intersected(b).intervals(), b.intervals() );
+}
+
+QTEST_GUILESS_MAIN(TestNodeSelection)
+
+#include "tst_nodeselection.moc"
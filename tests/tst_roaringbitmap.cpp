@@ -0,0 +1,183 @@
+#include <QtTest>
+#include <QDataStream>
+
+#include <functional>
+
+#include "roaringbitmap.h"
+
+class TestRoaringBitmap : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void addAndContains();
+    void arrayBecomesBitmap();
+    void intersectAndUnite();
+    void serializeRoundTrip();
+    void deserializeRejectsMalformed_data();
+    void deserializeRejectsMalformed();
+
+private:
+    static RoaringBitmap fromValues(const QVector<quint32> & values);
+    /// a container header as serialize() writes it
+    static void writeHeader(QDataStream & out, quint16 key, quint8 type, quint32 cardinality);
+};
+
+RoaringBitmap TestRoaringBitmap::fromValues(const QVector<quint32> &values)
+{
+    RoaringBitmap bitmap;
+    foreach( quint32 value, values ) {
+        bitmap.add(value);
+    }
+    return bitmap;
+}
+
+void TestRoaringBitmap::writeHeader(QDataStream &out, quint16 key, quint8 type, quint32 cardinality)
+{
+    out << key << type << cardinality;
+}
+
+void TestRoaringBitmap::addAndContains()
+{
+    RoaringBitmap bitmap;
+    QVERIFY( bitmap.isEmpty() );
+
+    /// out of order, with a repeat, and across containers
+    bitmap.add(70000);
+    bitmap.add(5);
+    bitmap.add(65535);
+    bitmap.add(5);
+    bitmap.add(0);
+
+    QCOMPARE( bitmap.cardinality(), quint64(4) );
+    QVERIFY( bitmap.contains(0) );
+    QVERIFY( bitmap.contains(5) );
+    QVERIFY( bitmap.contains(65535) );
+    QVERIFY( bitmap.contains(70000) );
+    QVERIFY( !bitmap.contains(6) );
+    QVERIFY( !bitmap.contains(65536) );
+    QCOMPARE( bitmap.toVector(), QVector<quint32>() << 0 << 5 << 65535 << 70000 );
+}
+
+void TestRoaringBitmap::arrayBecomesBitmap()
+{
+    /// every third number, so that one container goes past the 4096-entry array limit
+    QVector<quint32> values;
+    for(quint32 n = 0; n < 3 * 5000; n += 3) {
+        values << n;
+    }
+    const RoaringBitmap bitmap = fromValues(values);
+    QCOMPARE( bitmap.cardinality(), quint64(5000) );
+    QCOMPARE( bitmap.toVector(), values );
+    QVERIFY( bitmap.contains(3 * 4999) );
+    QVERIFY( !bitmap.contains(3 * 4999 + 1) );
+}
+
+void TestRoaringBitmap::intersectAndUnite()
+{
+    QVector<quint32> dense, sparse;
+    for(quint32 n = 0; n < 10000; n++) {
+        dense << n;
+    }
+    sparse << 1 << 9999 << 10000 << 200000;
+
+    const RoaringBitmap a = fromValues(dense);
+    const RoaringBitmap b = fromValues(sparse);
+
+    QCOMPARE( RoaringBitmap::intersect(a, b).toVector(), QVector<quint32>() << 1 << 9999 );
+    QCOMPARE( RoaringBitmap::intersect(b, a).toVector(), QVector<quint32>() << 1 << 9999 );
+    QVERIFY( RoaringBitmap::intersect(a, RoaringBitmap()).isEmpty() );
+
+    const RoaringBitmap both = RoaringBitmap::unite(a, b);
+    QCOMPARE( both.cardinality(), quint64(10002) );
+    QVERIFY( both.contains(10000) );
+    QVERIFY( both.contains(200000) );
+    QCOMPARE( RoaringBitmap::unite(RoaringBitmap(), b).toVector(), sparse );
+}
+
+void TestRoaringBitmap::serializeRoundTrip()
+{
+    QVector<quint32> values;
+    for(quint32 n = 0; n < 6000; n++) {
+        values << n * 2;
+    }
+    values << 1000000 << 4000000000u;
+    const RoaringBitmap bitmap = fromValues(values);
+
+    const RoaringBitmap copy = RoaringBitmap::deserialize( bitmap.serialize() );
+    QCOMPARE( copy.cardinality(), bitmap.cardinality() );
+    QCOMPARE( copy.toVector(), values );
+
+    QVERIFY( RoaringBitmap::deserialize( RoaringBitmap().serialize() ).isEmpty() );
+}
+
+void TestRoaringBitmap::deserializeRejectsMalformed_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    auto blob = [](const std::function<void(QDataStream &)> & write) {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setByteOrder(QDataStream::LittleEndian);
+        write(out);
+        return data;
+    };
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("cut short") << fromValues( QVector<quint32>() << 1 << 2 << 3 ).serialize().left(12);
+    QTest::newRow("more containers than keys") << blob( [](QDataStream & out) { out << quint32(70000); } );
+    QTest::newRow("unknown type") << blob( [](QDataStream & out) {
+        out << quint32(1);
+        writeHeader(out, 0, 2, 1);
+        out << quint16(7);
+    } );
+    QTest::newRow("array too large") << blob( [](QDataStream & out) {
+        out << quint32(1);
+        writeHeader(out, 0, 0, 5000);
+        for(quint16 n = 0; n < 5000; n++) {
+            out << n;
+        }
+    } );
+    QTest::newRow("huge cardinality") << blob( [](QDataStream & out) {
+        out << quint32(1);
+        writeHeader(out, 0, 0, 0xFFFFFFFFu);
+    } );
+    QTest::newRow("unsorted array") << blob( [](QDataStream & out) {
+        out << quint32(1);
+        writeHeader(out, 0, 0, 2);
+        out << quint16(9) << quint16(3);
+    } );
+    QTest::newRow("unsorted keys") << blob( [](QDataStream & out) {
+        out << quint32(2);
+        writeHeader(out, 5, 0, 1);
+        out << quint16(1);
+        writeHeader(out, 2, 0, 1);
+        out << quint16(1);
+    } );
+    QTest::newRow("bitmap cardinality mismatch") << blob( [](QDataStream & out) {
+        out << quint32(1);
+        writeHeader(out, 0, 1, 100);
+        for(int w = 0; w < 1024; w++) {
+            out << quint64(w == 0 ? 1 : 0);
+        }
+    } );
+    QTest::newRow("bitmap cut short") << blob( [](QDataStream & out) {
+        out << quint32(1);
+        writeHeader(out, 0, 1, 64);
+        for(int w = 0; w < 10; w++) {
+            out << quint64(0xFFFFFFFFFFFFFFFFull);
+        }
+    } );
+}
+
+void TestRoaringBitmap::deserializeRejectsMalformed()
+{
+    QFETCH(QByteArray, data);
+    const RoaringBitmap bitmap = RoaringBitmap::deserialize(data);
+    QVERIFY( bitmap.isEmpty() );
+    QCOMPARE( bitmap.cardinality(), quint64(0) );
+}
+
+QTEST_GUILESS_MAIN(TestRoaringBitmap)
+
+#include "tst_roaringbitmap.moc"
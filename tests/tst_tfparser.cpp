@@ -0,0 +1,176 @@
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "nodeselection.h"
+#include "tffile.h"
+#include "tfparser.h"
+
+Q_DECLARE_METATYPE(TFParser::NodeColumn)
+
+/// Each kernel of TFParser against TFFile's general parser, over small
+/// files of every shape, with and without a node selection.
+class TestTFParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void kernelMatchesGeneralParser_data();
+    void kernelMatchesGeneralParser();
+    void integerValues();
+    void edgeValues();
+
+private:
+    /// a file in mFolder with @header, the blank line that ends it, and @body
+    QFileInfo writeFixture(const QString & name, const QByteArray & header, const QByteArray & body);
+    /// "node<TAB>value" (or "from<TAB>to<TAB>value") for every row, from each parser
+    static QStringList generalRows(TFFile & file);
+    static QStringList kernelRows(const TFFile & file);
+
+    QTemporaryDir mFolder;
+};
+
+void TestTFParser::initTestCase()
+{
+    QVERIFY( mFolder.isValid() );
+}
+
+QFileInfo TestTFParser::writeFixture(const QString &name, const QByteArray &header, const QByteArray &body)
+{
+    QFile file( mFolder.filePath(name + ".tf") );
+    if( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        return QFileInfo();
+    }
+    file.write( header + "@description=fixture\n\n" + body );
+    file.close();
+    return QFileInfo( file.fileName() );
+}
+
+QStringList TestTFParser::generalRows(TFFile &file)
+{
+    QStringList rows;
+    if( file.fileType() == TFFile::FileTypeNode ) {
+        file.readNodes( [&](unsigned int node, const QString & value) {
+            rows << QString("%1\t%2").arg(node).arg(value);
+        } );
+    } else {
+        file.readEdges( [&](unsigned int from, unsigned int to, const QString & value) {
+            rows << QString("%1\t%2\t%3").arg(from).arg(to).arg(value);
+        } );
+    }
+    return rows;
+}
+
+QStringList TestTFParser::kernelRows(const TFFile &file)
+{
+    QStringList rows;
+    if( file.fileType() == TFFile::FileTypeNode ) {
+        TFParser::parseNodes( file, [&](unsigned int node, const QVariant & value) {
+            rows << QString("%1\t%2").arg(node).arg(value.toString());
+        } );
+    } else {
+        TFParser::parseEdges( file, [&](unsigned int from, unsigned int to, const QVariant & value) {
+            rows << QString("%1\t%2\t%3").arg(from).arg(to).arg(value.toString());
+        } );
+    }
+    return rows;
+}
+
+void TestTFParser::kernelMatchesGeneralParser_data()
+{
+    QTest::addColumn<QByteArray>("header");
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<TFParser::NodeColumn>("column");
+
+    const QByteArray nodeInt = "@node\n@valueType=int\n";
+    const QByteArray nodeStr = "@node\n@valueType=str\n";
+    const QByteArray edgeInt = "@edge\n@valueType=int\n@edgeValues\n";
+    const QByteArray edgeStr = "@edge\n@valueType=str\n@edgeValues\n";
+    const QByteArray edgePlain = "@edge\n@valueType=str\n";
+
+    QTest::newRow("node/int/implicit") << nodeInt << QByteArray("5\n\n-3\n7\nx1\n12\n0\n4\n9\n1\n") << TFParser::NodeColumnImplicit;
+    QTest::newRow("node/int/explicit") << nodeInt << QByteArray("1\t5\n3-4\t2\n6,8\t\n9\t-1\n10-12\t40\n") << TFParser::NodeColumnExplicit;
+    QTest::newRow("node/int/mixed") << nodeInt << QByteArray("5\n3-4\t2\n9\n7,10\t1\n11\n\n") << TFParser::NodeColumnMixed;
+
+    QTest::newRow("node/str/implicit") << nodeStr << QByteArray("in\n\xd7\x90\xd7\x91\n\na\\tb\nc\\\\d\ne\\nf\nthe\nend\nof\nit\n") << TFParser::NodeColumnImplicit;
+    QTest::newRow("node/str/explicit") << nodeStr << QByteArray("1\tin\n2-3\t\xce\xb1\n5,4\t\n7\ta\\tb\n8-11\tz\n") << TFParser::NodeColumnExplicit;
+    QTest::newRow("node/str/mixed") << nodeStr << QByteArray("in\n3-4\tthe\n\n6\tbeginning\nwas\n8,10\tthe\nword\n") << TFParser::NodeColumnMixed;
+
+    QTest::newRow("edge/int/values/implicit") << edgeInt << QByteArray("2\t1\n3-4\t\n5\t7\n9,1\t-2\n6\t3\n2\t0\n8\t8\n") << TFParser::NodeColumnImplicit;
+    QTest::newRow("edge/int/values/explicit") << edgeInt << QByteArray("1\t2\t1\n1\t3-4\t\n2,5\t6\t9\n7-8\t1-2\t100\n") << TFParser::NodeColumnExplicit;
+    QTest::newRow("edge/int/values/mixed") << edgeInt << QByteArray("2\t1\n1-2\t5\t3\n7\t4\n6\t8\t\n9\t1\n") << TFParser::NodeColumnMixed;
+
+    QTest::newRow("edge/str/values/implicit") << edgeStr << QByteArray("2\tsubj\n3\tobj\n4-5\t\n1\t\xce\xb1\\t\xce\xb2\n6\tpred\n7\tx\n8\ty\n") << TFParser::NodeColumnImplicit;
+    QTest::newRow("edge/str/values/explicit") << edgeStr << QByteArray("1\t2\tsubj\n2\t3-4\t\xce\xb1\\t\xce\xb2\n3,6\t7\t\n8-9\t1\tz\n") << TFParser::NodeColumnExplicit;
+    QTest::newRow("edge/str/values/mixed") << edgeStr << QByteArray("2\tx\n2\t3\ty\n4\tz\n6-7\t8\t\n9\tw\n") << TFParser::NodeColumnMixed;
+
+    QTest::newRow("edge/novalues/implicit") << edgePlain << QByteArray("2\n3-4\n5\n1,9\n6\n7\n8\n") << TFParser::NodeColumnImplicit;
+    QTest::newRow("edge/novalues/explicit") << edgePlain << QByteArray("1\t2\n1\t3-4\n3,5\t6\n7-9\t1\n") << TFParser::NodeColumnExplicit;
+    QTest::newRow("edge/novalues/mixed") << edgePlain << QByteArray("2\n2-3\t4\n5\n7\t8-9\n1\n") << TFParser::NodeColumnMixed;
+}
+
+void TestTFParser::kernelMatchesGeneralParser()
+{
+    QFETCH(QByteArray, header);
+    QFETCH(QByteArray, body);
+    QFETCH(TFParser::NodeColumn, column);
+
+    const QFileInfo info = writeFixture( QString(QTest::currentDataTag()).replace("/", "_"), header, body );
+    QVERIFY( info.exists() );
+
+    const QList<NodeSelection> selections = QList<NodeSelection>()
+            << NodeSelection()
+            << NodeSelection( NodeSelection::Intervals() << NodeSelection::Interval(2, 3) << NodeSelection::Interval(6, 9) );
+    foreach( const NodeSelection & selection, selections ) {
+        TFFile file(info);
+        file.setSelection(selection);
+        file.scanStatistics( QHash<QString,QPair<unsigned int,unsigned int>>() );
+        QCOMPARE( TFParser::nodeColumn( file.statistics() ), column );
+
+        const QStringList expected = generalRows(file);
+        QVERIFY( !expected.isEmpty() );
+        QCOMPARE( kernelRows(file), expected );
+        QCOMPARE( static_cast<qint64>(expected.count()), file.statistics().rowCount );
+    }
+}
+
+void TestTFParser::integerValues()
+{
+    const QFileInfo info = writeFixture( "integers", "@node\n@valueType=int\n", "5\n\n-3\n4\tx1\n" );
+    TFFile file(info);
+    file.scanStatistics( QHash<QString,QPair<unsigned int,unsigned int>>() );
+
+    QVariantList values;
+    TFParser::parseNodes( file, [&](unsigned int, const QVariant & value) { values << value; } );
+    QCOMPARE( values.count(), 4 );
+    QCOMPARE( values.at(0).type(), QVariant::LongLong );
+    QCOMPARE( values.at(0).toLongLong(), Q_INT64_C(5) );
+    /// an empty integer value is NULL rather than 0
+    QVERIFY( values.at(1).isNull() );
+    QCOMPARE( values.at(2).toLongLong(), Q_INT64_C(-3) );
+    /// anything that isn't a number is kept as it is
+    QCOMPARE( values.at(3).type(), QVariant::String );
+    QCOMPARE( values.at(3).toString(), QString("x1") );
+}
+
+void TestTFParser::edgeValues()
+{
+    const QFileInfo info = writeFixture( "edgevalues", "@edge\n@valueType=int\n@edgeValues\n", "1\t2\t7\n1\t3\t\n3\n" );
+    TFFile file(info);
+    file.scanStatistics( QHash<QString,QPair<unsigned int,unsigned int>>() );
+
+    QVariantList values;
+    TFParser::parseEdges( file, [&](unsigned int, unsigned int, const QVariant & value) { values << value; } );
+    QCOMPARE( values.count(), 3 );
+    QCOMPARE( values.at(0).type(), QVariant::LongLong );
+    QCOMPARE( values.at(0).toLongLong(), Q_INT64_C(7) );
+    /// edges without a value get an empty string, never NULL
+    QCOMPARE( values.at(1).type(), QVariant::String );
+    QVERIFY( !values.at(1).isNull() );
+    QCOMPARE( values.at(1).toString(), QString("") );
+    QCOMPARE( values.at(2).toString(), QString("") );
+}
+
+QTEST_GUILESS_MAIN(TestTFParser)
+
+#include "tst_tfparser.moc"
@@ -0,0 +1,107 @@
+#include <QtTest>
+
+#include <functional>
+
+#include "throughputtuner.h"
+
+class TestThroughputTuner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void climbsToThePeak();
+    void stopsAtABound();
+    void ignoresMeasurementsOnceSettled();
+    void shortWindowsAreGrouped();
+    void fixedValueNeverChanges();
+
+private:
+    /// feed @tuner one full window at a time, at the rate @rateAt gives for its
+    /// current value, until it settles; the number of windows it took
+    static int runUntilSettled(ThroughputTuner & tuner, const std::function<double(int)> & rateAt);
+};
+
+int TestThroughputTuner::runUntilSettled(ThroughputTuner &tuner, const std::function<double(int)> &rateAt)
+{
+    /// a second is past any window length
+    const qint64 second = 1000 * 1000 * 1000;
+    int windows = 0;
+    while( !tuner.isSettled() && windows < 100 ) {
+        tuner.record( static_cast<qint64>( rateAt( tuner.value() ) ), second );
+        windows++;
+    }
+    return windows;
+}
+
+void TestThroughputTuner::climbsToThePeak()
+{
+    ThroughputTuner tuner(1000, 10, 100000);
+    /// best at 4000: 1000 and 2000 are slower, and so is 8000
+    const int windows = runUntilSettled( tuner, [](int value) {
+        switch( value ) {
+        case 1000: return 10000.0;
+        case 2000: return 20000.0;
+        case 4000: return 30000.0;
+        case 8000: return 25000.0;
+        default: return 5000.0;
+        }
+    } );
+    QVERIFY( tuner.isSettled() );
+    QCOMPARE( tuner.value(), 4000 );
+    QCOMPARE( tuner.bestRate(), 30000.0 );
+    /// 1000, 2000, 4000, then one failed step each way
+    QCOMPARE( windows, 5 );
+}
+
+void TestThroughputTuner::stopsAtABound()
+{
+    ThroughputTuner tuner(1000, 10, 4000);
+    /// faster the larger the value, but the maximum is 4000
+    runUntilSettled( tuner, [](int value) { return static_cast<double>(value); } );
+    QVERIFY( tuner.isSettled() );
+    QCOMPARE( tuner.value(), 4000 );
+}
+
+void TestThroughputTuner::ignoresMeasurementsOnceSettled()
+{
+    ThroughputTuner tuner(100, 10, 1000);
+    /// nothing ever beats the first value
+    runUntilSettled( tuner, [](int value) { return value == 100 ? 1000.0 : 500.0; } );
+    QVERIFY( tuner.isSettled() );
+    QCOMPARE( tuner.value(), 100 );
+
+    tuner.record( 1000 * 1000 * 1000, 1000 * 1000 * 1000 );
+    QCOMPARE( tuner.value(), 100 );
+    QCOMPARE( tuner.bestRate(), 1000.0 );
+}
+
+void TestThroughputTuner::shortWindowsAreGrouped()
+{
+    ThroughputTuner tuner(1000, 10, 100000);
+    /// a millisecond is too short to judge, so the value stays until enough has been seen
+    for(int i = 0; i < 100; i++) {
+        tuner.record( 1000, 1000 * 1000 );
+    }
+    QCOMPARE( tuner.value(), 1000 );
+    QCOMPARE( tuner.bestRate(), 0.0 );
+
+    for(int i = 0; i < 200; i++) {
+        tuner.record( 1000, 1000 * 1000 );
+    }
+    QCOMPARE( tuner.value(), 2000 );
+    QVERIFY( tuner.bestRate() > 0.0 );
+}
+
+void TestThroughputTuner::fixedValueNeverChanges()
+{
+    ThroughputTuner tuner(1000, 10, 100000);
+    tuner.setFixed(250);
+    QVERIFY( tuner.isFixed() );
+    QVERIFY( tuner.isSettled() );
+    tuner.record( 1000 * 1000, 1000 * 1000 * 1000 );
+    QCOMPARE( tuner.value(), 250 );
+}
+
+QTEST_GUILESS_MAIN(TestThroughputTuner)
+
+#include "tst_throughputtuner.moc"
@@ -0,0 +1,430 @@
+#include "textfabriccorpus.h"
+
+#include <QtDebug>
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace {
+/// text offsets are 32-bit, and the last offset is the size of the text
+const size_t MaximumTextBytes = 0xFFFFFFFFu;
+}
+
+TextFabricCorpus::StringColumn::StringColumn() :
+    mFirst(0),
+    mCount(0),
+    mPresent(nullptr),
+    mOffsets(nullptr),
+    mText(nullptr)
+{
+}
+
+bool TextFabricCorpus::StringColumn::isValid() const
+{
+    return mPresent != nullptr;
+}
+
+unsigned int TextFabricCorpus::StringColumn::firstNode() const
+{
+    return mFirst;
+}
+
+unsigned int TextFabricCorpus::StringColumn::lastNode() const
+{
+    return mFirst + mCount - 1;
+}
+
+bool TextFabricCorpus::StringColumn::hasValue(unsigned int node) const
+{
+    return node >= mFirst && node - mFirst < mCount && mPresent[node - mFirst];
+}
+
+std::string_view TextFabricCorpus::StringColumn::value(unsigned int node) const
+{
+    if( !hasValue(node) ) {
+        return std::string_view();
+    }
+    const unsigned int i = node - mFirst;
+    return std::string_view( mText + mOffsets[i], mOffsets[i + 1] - mOffsets[i] );
+}
+
+TextFabricCorpus::IntegerColumn::IntegerColumn() :
+    mFirst(0),
+    mCount(0),
+    mPresent(nullptr),
+    mValues(nullptr)
+{
+}
+
+bool TextFabricCorpus::IntegerColumn::isValid() const
+{
+    return mPresent != nullptr;
+}
+
+unsigned int TextFabricCorpus::IntegerColumn::firstNode() const
+{
+    return mFirst;
+}
+
+unsigned int TextFabricCorpus::IntegerColumn::lastNode() const
+{
+    return mFirst + mCount - 1;
+}
+
+bool TextFabricCorpus::IntegerColumn::hasValue(unsigned int node) const
+{
+    return node >= mFirst && node - mFirst < mCount && mPresent[node - mFirst];
+}
+
+qint64 TextFabricCorpus::IntegerColumn::value(unsigned int node) const
+{
+    return hasValue(node) ? mValues[node - mFirst] : 0;
+}
+
+const qint64 *TextFabricCorpus::IntegerColumn::data() const
+{
+    return mValues;
+}
+
+TextFabricCorpus::EdgeSet::Targets::Targets(const quint32 *begin, const quint32 *end) :
+    mBegin(begin),
+    mEnd(end)
+{
+}
+
+const quint32 *TextFabricCorpus::EdgeSet::Targets::begin() const
+{
+    return mBegin;
+}
+
+const quint32 *TextFabricCorpus::EdgeSet::Targets::end() const
+{
+    return mEnd;
+}
+
+int TextFabricCorpus::EdgeSet::Targets::size() const
+{
+    return static_cast<int>(mEnd - mBegin);
+}
+
+bool TextFabricCorpus::EdgeSet::Targets::isEmpty() const
+{
+    return mBegin == mEnd;
+}
+
+TextFabricCorpus::EdgeSet::EdgeSet() :
+    mFirst(0),
+    mCount(0),
+    mRowOffsets(nullptr),
+    mTargets(nullptr),
+    mValueOffsets(nullptr),
+    mValueText(nullptr)
+{
+}
+
+bool TextFabricCorpus::EdgeSet::isValid() const
+{
+    return mRowOffsets != nullptr;
+}
+
+bool TextFabricCorpus::EdgeSet::hasValues() const
+{
+    return mValueOffsets != nullptr;
+}
+
+qint64 TextFabricCorpus::EdgeSet::edgeIndex(unsigned int from) const
+{
+    if( from < mFirst || from - mFirst >= mCount ) {
+        return -1;
+    }
+    return static_cast<qint64>( mRowOffsets[from - mFirst] );
+}
+
+TextFabricCorpus::EdgeSet::Targets TextFabricCorpus::EdgeSet::targets(unsigned int from) const
+{
+    const qint64 begin = edgeIndex(from);
+    if( begin < 0 ) {
+        return Targets(nullptr, nullptr);
+    }
+    return Targets( mTargets + begin, mTargets + mRowOffsets[from - mFirst + 1] );
+}
+
+std::string_view TextFabricCorpus::EdgeSet::value(unsigned int from, int index) const
+{
+    const qint64 begin = edgeIndex(from);
+    if( !hasValues() || begin < 0 || index < 0 || begin + index >= static_cast<qint64>( mRowOffsets[from - mFirst + 1] ) ) {
+        return std::string_view();
+    }
+    const qint64 e = begin + index;
+    return std::string_view( mValueText + mValueOffsets[e], mValueOffsets[e + 1] - mValueOffsets[e] );
+}
+
+TextFabricCorpus::TextFabricCorpus()
+{
+}
+
+TextFabricCorpus::~TextFabricCorpus()
+{
+}
+
+bool TextFabricCorpus::load(const QString &folderPath, const QStringList &features)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QDir folder(folderPath);
+    if( !folder.exists("otype.tf") ) {
+        qCritical() << "TextFabricCorpus::load" << "No otype.tf in" << folderPath;
+        return false;
+    }
+    mOTypeRanges = TFFile::readOTypeRanges( folder.absoluteFilePath("otype.tf") );
+
+    std::vector<TFFile> files;
+    foreach( QFileInfo info, folder.entryInfoList(QStringList("*.tf"), QDir::Files) ) {
+        if( info.fileName() == "otype.tf" || info.fileName() == "otext.tf" || info.fileName().startsWith("omap@") ) {
+            continue;
+        }
+        if( !features.isEmpty() && !features.contains( info.baseName() ) ) {
+            continue;
+        }
+        TFFile file(info);
+        if( file.fileType() != TFFile::FileTypeConfig ) {
+            files.push_back(file);
+        }
+    }
+
+    /// each file fills its own slot, so the threads share nothing
+    std::vector<std::shared_ptr<NodeFeature>> nodeFeatures( files.size() );
+    std::vector<std::shared_ptr<EdgeFeature>> edgeFeatures( files.size() );
+    std::vector<char> loaded( files.size(), 0 );
+    parallelFor( 0, static_cast<int>(files.size()), [&](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            if( files[i].fileType() == TFFile::FileTypeNode ) {
+                nodeFeatures[i].reset( new NodeFeature );
+                loaded[i] = loadNodeFeature( files[i], *nodeFeatures[i] );
+            } else {
+                edgeFeatures[i].reset( new EdgeFeature );
+                loaded[i] = loadEdgeFeature( files[i], *edgeFeatures[i] );
+            }
+        }
+    } );
+
+    bool ok = true;
+    for(size_t i = 0; i < files.size(); i++) {
+        if( !loaded[i] ) {
+            ok = false;
+        } else if( nodeFeatures[i] ) {
+            mNodeFeatures.insert( files[i].label(), nodeFeatures[i] );
+        } else {
+            mEdgeFeatures.insert( files[i].label(), edgeFeatures[i] );
+        }
+    }
+
+    qDebug() << "Loaded" << files.size() << "features in" << timer.elapsed() << "milliseconds";
+    return ok;
+}
+
+bool TextFabricCorpus::loadNodeFeature(TFFile &file, NodeFeature &feature)
+{
+    feature.type = file.valueType();
+
+    std::vector<std::pair<unsigned int, QByteArray>> values;
+    file.readNodes( [&](unsigned int node, const QString & value) {
+        values.emplace_back( node, value.toUtf8() );
+    } );
+    /// files list nodes in ascending order; a later line for the same node wins
+    std::stable_sort( values.begin(), values.end(), [](const std::pair<unsigned int, QByteArray> & a, const std::pair<unsigned int, QByteArray> & b) {
+        return a.first < b.first;
+    } );
+
+    if( values.empty() ) {
+        feature.first = 0;
+        return true;
+    }
+    feature.first = values.front().first;
+    const size_t count = values.back().first - feature.first + 1;
+    feature.present.assign( count, 0 );
+
+    if( feature.type == TFFile::ValueTypeInteger ) {
+        feature.integers.assign( count, 0 );
+        for(const auto & value : values) {
+            bool ok = false;
+            const qint64 number = value.second.toLongLong(&ok);
+            if( ok ) {
+                feature.integers[ value.first - feature.first ] = number;
+                feature.present[ value.first - feature.first ] = 1;
+            }
+        }
+        return true;
+    }
+
+    feature.offsets.assign( count + 1, 0 );
+    size_t next = 0;
+    for(size_t v = 0; v < values.size(); v++) {
+        if( v + 1 < values.size() && values[v + 1].first == values[v].first ) {
+            continue;
+        }
+        const size_t i = values[v].first - feature.first;
+        /// the nodes without a value in between get empty strings
+        while( next <= i ) {
+            feature.offsets[next++] = static_cast<quint32>( feature.text.size() );
+        }
+        if( feature.text.size() + static_cast<size_t>(values[v].second.size()) > MaximumTextBytes ) {
+            qCritical() << "TextFabricCorpus::loadNodeFeature" << file.label() << "holds more than 4 GB of text";
+            return false;
+        }
+        feature.text.append( values[v].second.constData(), static_cast<size_t>(values[v].second.size()) );
+        feature.present[i] = 1;
+    }
+    while( next <= count ) {
+        feature.offsets[next++] = static_cast<quint32>( feature.text.size() );
+    }
+    return true;
+}
+
+bool TextFabricCorpus::loadEdgeFeature(TFFile &file, EdgeFeature &feature)
+{
+    feature.hasValues = file.hasEdgeValues();
+
+    struct Edge {
+        quint32 from;
+        quint32 to;
+        QByteArray value;
+    };
+    std::vector<Edge> edges;
+    file.readEdges( [&](unsigned int from, unsigned int to, const QString & value) {
+        Edge edge;
+        edge.from = from;
+        edge.to = to;
+        if( feature.hasValues ) {
+            edge.value = value.toUtf8();
+        }
+        edges.push_back(edge);
+    } );
+    std::stable_sort( edges.begin(), edges.end(), [](const Edge & a, const Edge & b) {
+        return a.from < b.from || ( a.from == b.from && a.to < b.to );
+    } );
+
+    if( edges.empty() ) {
+        feature.first = 0;
+        feature.rowOffsets.assign( 1, 0 );
+        return true;
+    }
+    feature.first = edges.front().from;
+    const size_t count = edges.back().from - feature.first + 1;
+
+    /// row i holds the edges of node first + i, from rowOffsets[i] to rowOffsets[i + 1]
+    feature.rowOffsets.assign( count + 1, 0 );
+    feature.targets.reserve( edges.size() );
+    if( feature.hasValues ) {
+        feature.valueOffsets.reserve( edges.size() + 1 );
+    }
+    for(const Edge & edge : edges) {
+        feature.rowOffsets[ edge.from - feature.first + 1 ]++;
+        feature.targets.push_back( edge.to );
+        if( feature.hasValues ) {
+            if( feature.valueText.size() + static_cast<size_t>(edge.value.size()) > MaximumTextBytes ) {
+                qCritical() << "TextFabricCorpus::loadEdgeFeature" << file.label() << "holds more than 4 GB of values";
+                return false;
+            }
+            feature.valueOffsets.push_back( static_cast<quint32>( feature.valueText.size() ) );
+            feature.valueText.append( edge.value.constData(), static_cast<size_t>(edge.value.size()) );
+        }
+    }
+    for(size_t i = 1; i <= count; i++) {
+        feature.rowOffsets[i] += feature.rowOffsets[i - 1];
+    }
+    if( feature.hasValues ) {
+        feature.valueOffsets.push_back( static_cast<quint32>( feature.valueText.size() ) );
+    }
+    return true;
+}
+
+QStringList TextFabricCorpus::otypes() const
+{
+    return mOTypeRanges.keys();
+}
+
+QPair<unsigned int, unsigned int> TextFabricCorpus::otypeRange(const QString &otype) const
+{
+    return mOTypeRanges.value(otype, QPair<unsigned int,unsigned int>(0, 0));
+}
+
+QString TextFabricCorpus::otype(unsigned int node) const
+{
+    QHashIterator<QString,QPair<unsigned int,unsigned int>> i( mOTypeRanges );
+    while (i.hasNext()) {
+        i.next();
+        if( node >= i.value().first && node <= i.value().second ) {
+            return i.key();
+        }
+    }
+    return QString();
+}
+
+QStringList TextFabricCorpus::nodeFeatures() const
+{
+    return mNodeFeatures.keys();
+}
+
+QStringList TextFabricCorpus::edgeFeatures() const
+{
+    return mEdgeFeatures.keys();
+}
+
+TFFile::ValueType TextFabricCorpus::valueType(const QString &feature) const
+{
+    if( mNodeFeatures.contains(feature) ) {
+        return mNodeFeatures.value(feature)->type;
+    }
+    return TFFile::ValueTypeString;
+}
+
+TextFabricCorpus::StringColumn TextFabricCorpus::stringColumn(const QString &feature) const
+{
+    StringColumn column;
+    const std::shared_ptr<NodeFeature> f = mNodeFeatures.value(feature);
+    if( !f || f->type != TFFile::ValueTypeString || f->present.empty() ) {
+        return column;
+    }
+    column.mFirst = f->first;
+    column.mCount = static_cast<unsigned int>( f->present.size() );
+    column.mPresent = f->present.data();
+    column.mOffsets = f->offsets.data();
+    column.mText = f->text.data();
+    return column;
+}
+
+TextFabricCorpus::IntegerColumn TextFabricCorpus::integerColumn(const QString &feature) const
+{
+    IntegerColumn column;
+    const std::shared_ptr<NodeFeature> f = mNodeFeatures.value(feature);
+    if( !f || f->type != TFFile::ValueTypeInteger || f->present.empty() ) {
+        return column;
+    }
+    column.mFirst = f->first;
+    column.mCount = static_cast<unsigned int>( f->present.size() );
+    column.mPresent = f->present.data();
+    column.mValues = f->integers.data();
+    return column;
+}
+
+TextFabricCorpus::EdgeSet TextFabricCorpus::edges(const QString &feature) const
+{
+    EdgeSet edges;
+    const std::shared_ptr<EdgeFeature> f = mEdgeFeatures.value(feature);
+    if( !f ) {
+        return edges;
+    }
+    edges.mFirst = f->first;
+    edges.mCount = static_cast<unsigned int>( f->rowOffsets.size() - 1 );
+    edges.mRowOffsets = f->rowOffsets.data();
+    edges.mTargets = f->targets.data();
+    if( f->hasValues ) {
+        edges.mValueOffsets = f->valueOffsets.data();
+        edges.mValueText = f->valueText.data();
+    }
+    return edges;
+}
@@ -0,0 +1,144 @@
+#ifndef TEXTFABRICCORPUS_H
+#define TEXTFABRICCORPUS_H
+
+#include <QDir>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tffile.h"
+
+/// A TF folder loaded into memory once, for programs that want the data in
+/// their own process rather than from a database. Node features are held in
+/// flat columns indexed by node and edge features in compressed sparse rows;
+/// the accessors hand out views of that storage, which stay valid as long as
+/// the corpus does.
+class TextFabricCorpus
+{
+public:
+    /// the values of one node feature, for nodes firstNode() to lastNode()
+    class StringColumn {
+    public:
+        StringColumn();
+        bool isValid() const;
+        unsigned int firstNode() const;
+        unsigned int lastNode() const;
+        bool hasValue(unsigned int node) const;
+        /// UTF-8, and empty if the node has no value
+        std::string_view value(unsigned int node) const;
+    private:
+        friend class TextFabricCorpus;
+        unsigned int mFirst;
+        unsigned int mCount;
+        const quint8 * mPresent;
+        const quint32 * mOffsets;
+        const char * mText;
+    };
+
+    class IntegerColumn {
+    public:
+        IntegerColumn();
+        bool isValid() const;
+        unsigned int firstNode() const;
+        unsigned int lastNode() const;
+        bool hasValue(unsigned int node) const;
+        /// 0 if the node has no value
+        qint64 value(unsigned int node) const;
+        /// the values themselves, one per node from firstNode()
+        const qint64 * data() const;
+    private:
+        friend class TextFabricCorpus;
+        unsigned int mFirst;
+        unsigned int mCount;
+        const quint8 * mPresent;
+        const qint64 * mValues;
+    };
+
+    /// one edge feature, with the edges of each from-node sorted by to-node
+    class EdgeSet {
+    public:
+        /// the edges of one node, as a range of to-nodes
+        class Targets {
+        public:
+            Targets(const quint32 * begin, const quint32 * end);
+            const quint32 * begin() const;
+            const quint32 * end() const;
+            int size() const;
+            bool isEmpty() const;
+        private:
+            const quint32 * mBegin;
+            const quint32 * mEnd;
+        };
+
+        EdgeSet();
+        bool isValid() const;
+        bool hasValues() const;
+        Targets targets(unsigned int from) const;
+        /// the value of the @index-th edge of @from, in UTF-8
+        std::string_view value(unsigned int from, int index) const;
+    private:
+        friend class TextFabricCorpus;
+        qint64 edgeIndex(unsigned int from) const;
+        unsigned int mFirst;
+        unsigned int mCount;
+        const quint64 * mRowOffsets;
+        const quint32 * mTargets;
+        const quint32 * mValueOffsets;
+        const char * mValueText;
+    };
+
+    TextFabricCorpus();
+    ~TextFabricCorpus();
+
+    /// read otype.tf and the node and edge files of @folderPath, in parallel;
+    /// an empty @features reads every file. False if any file could not be
+    /// held, e.g., one with more than 4 GB of text, which is then left out.
+    bool load(const QString & folderPath, const QStringList & features = QStringList());
+
+    QStringList otypes() const;
+    QPair<unsigned int,unsigned int> otypeRange(const QString & otype) const;
+    /// empty if @node is in no otype's range
+    QString otype(unsigned int node) const;
+
+    QStringList nodeFeatures() const;
+    QStringList edgeFeatures() const;
+    TFFile::ValueType valueType(const QString & feature) const;
+
+    /// invalid if @feature is not loaded or has the other value type
+    StringColumn stringColumn(const QString & feature) const;
+    IntegerColumn integerColumn(const QString & feature) const;
+    EdgeSet edges(const QString & feature) const;
+
+private:
+    struct NodeFeature {
+        TFFile::ValueType type;
+        unsigned int first;
+        std::vector<quint8> present;
+        std::vector<qint64> integers;
+        std::vector<quint32> offsets;
+        std::string text;
+    };
+    struct EdgeFeature {
+        bool hasValues;
+        unsigned int first;
+        std::vector<quint64> rowOffsets;
+        std::vector<quint32> targets;
+        std::vector<quint32> valueOffsets;
+        std::string valueText;
+    };
+
+    /// false if the text overflows the 32-bit offsets
+    static bool loadNodeFeature(TFFile & file, NodeFeature & feature);
+    static bool loadEdgeFeature(TFFile & file, EdgeFeature & feature);
+
+    QHash<QString,QPair<unsigned int,unsigned int>> mOTypeRanges;
+    QHash<QString,std::shared_ptr<NodeFeature>> mNodeFeatures;
+    QHash<QString,std::shared_ptr<EdgeFeature>> mEdgeFeatures;
+};
+
+#endif // TEXTFABRICCORPUS_H
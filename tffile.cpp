@@ -1,11 +1,111 @@
 #include "tffile.h"
 
 #include <QDebug>
+#include <QRegExp>
+
+#include <algorithm>
+#include <iterator>
+#include <set>
 
 #include "abstractdatabaseadapter.h"
+#include "tfparser.h"
+
+namespace {
+
+/// FNV-1a, which is plenty for estimating distinct values
+quint64 hashBytes(const char * data, int length)
+{
+    quint64 hash = 14695981039346656037ULL;
+    for(int i=0; i<length; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/// A k-minimum-values sketch: keep the k smallest hashes; if the kth smallest
+/// is x (as a fraction of the hash space), there are about (k-1)/x distinct values.
+class DistinctValueEstimator
+{
+public:
+    void add(const char * data, int length)
+    {
+        const quint64 hash = hashBytes(data, length);
+        if( mHashes.size() < K ) {
+            mHashes.insert(hash);
+        } else if( hash < *mHashes.rbegin() && mHashes.find(hash) == mHashes.end() ) {
+            mHashes.insert(hash);
+            mHashes.erase( std::prev(mHashes.end()) );
+        }
+    }
+
+    int estimate() const
+    {
+        if( mHashes.size() < K ) {
+            return static_cast<int>(mHashes.size());
+        }
+        const double kth = static_cast<double>(*mHashes.rbegin()) / 18446744073709551615.0;
+        return static_cast<int>( qMin( (K - 1) / qMax(kth, 1e-12), 2147483647.0 ) );
+    }
+
+private:
+    static const size_t K = 1024;
+    std::set<quint64> mHashes;
+};
+
+/// the intervals of a range string like 1-3,5-10,15; reversed pairs are swapped
+NodeSelection::Intervals intervals(const QByteArray & range)
+{
+    NodeSelection::Intervals result;
+    foreach( const QByteArray & part, range.split(',') ) {
+        const int dash = part.indexOf('-');
+        unsigned int a = (dash < 0 ? part : part.left(dash)).toUInt();
+        unsigned int b = dash < 0 ? a : part.mid(dash + 1).toUInt();
+        if( a > b ) {
+            qSwap(a, b);
+        }
+        result << qMakePair(a, b);
+    }
+    return result;
+}
+
+qint64 intervalsSize(const NodeSelection::Intervals & list)
+{
+    qint64 size = 0;
+    foreach( const auto & interval, list ) {
+        size += interval.second - interval.first + 1;
+    }
+    return size;
+}
+
+int utf8Length(const QByteArray & bytes)
+{
+    int length = 0;
+    for(int i=0; i<bytes.length(); i++) {
+        if( (static_cast<unsigned char>(bytes.at(i)) & 0xC0) != 0x80 ) {
+            length++;
+        }
+    }
+    return length;
+}
+
+}
+
+TFFile::Statistics::Statistics() :
+    rowCount(0),
+    distinctValues(0),
+    hasIntegers(false),
+    minimumInteger(0),
+    maximumInteger(0),
+    maximumStringLength(0),
+    explicitLines(0),
+    implicitLines(0)
+{
+}
 
 TFFile::TFFile(const QFileInfo & info) :
-    mInfo(info)
+    mInfo(info),
+    mRowsParsed(false)
 {
     QFile file(mInfo.absoluteFilePath());
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
@@ -41,13 +141,180 @@ TFFile::ValueType TFFile::valueType() const
     return mValueType;
 }
 
+bool TFFile::hasEdgeValues() const
+{
+    return mHasEdgeValues;
+}
+
 QString TFFile::label() const
 {
     return mInfo.baseName();
 }
 
+const TFFile::Statistics &TFFile::statistics() const
+{
+    return mStatistics;
+}
+
+void TFFile::setSelection(const NodeSelection &selection)
+{
+    mSelection = selection;
+}
+
+const NodeSelection &TFFile::selection() const
+{
+    return mSelection;
+}
+
+void TFFile::readEdgeRanges(const EdgeRangeCallback &callback)
+{
+    QFile file(mInfo.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qCritical() << "File could not be opened: " << mInfo.absoluteFilePath();
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    readEdgeRanges(&stream, callback);
+}
+
+void TFFile::scanStatistics(const QHash<QString, QPair<unsigned int, unsigned int> > &oTypeRanges)
+{
+    mStatistics = Statistics();
+
+    QFile file(mInfo.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qCritical() << "File could not be opened: " << mInfo.absoluteFilePath();
+        return;
+    }
+
+    /// the same header handling as skipOverHeader
+    QByteArray line;
+    do {
+        line = file.readLine();
+    } while( !line.isEmpty() && line.at(0) == '@' );
+
+    DistinctValueEstimator distinct;
+    unsigned int implicitNode = 0;
+
+    auto coverNodes = [&](const NodeSelection::Intervals & nodes) {
+        QHashIterator<QString,QPair<unsigned int,unsigned int>> i( oTypeRanges );
+        while (i.hasNext()) {
+            i.next();
+            foreach( const auto & interval, nodes ) {
+                if( interval.first <= i.value().second && interval.second >= i.value().first ) {
+                    mStatistics.otypes << i.key();
+                    break;
+                }
+            }
+        }
+    };
+    auto clip = [&](const NodeSelection::Intervals & nodes) {
+        if( mSelection.isEverything() ) {
+            return nodes;
+        }
+        return mSelection.clip( NodeSelection::normalized(nodes) );
+    };
+    auto addValue = [&](const QByteArray & value) {
+        distinct.add(value.constData(), value.length());
+        mStatistics.maximumStringLength = qMax( mStatistics.maximumStringLength, utf8Length(value) );
+        bool ok = false;
+        const qint64 number = value.toLongLong(&ok);
+        if( ok ) {
+            mStatistics.minimumInteger = mStatistics.hasIntegers ? qMin(mStatistics.minimumInteger, number) : number;
+            mStatistics.maximumInteger = mStatistics.hasIntegers ? qMax(mStatistics.maximumInteger, number) : number;
+            mStatistics.hasIntegers = true;
+        }
+    };
+
+    while( !file.atEnd() ) {
+        line = file.readLine();
+        if( line.endsWith('\n') ) {
+            line.chop(1);
+        }
+        if( line.endsWith('\r') ) {
+            line.chop(1);
+        }
+        const QList<QByteArray> dataLine = line.split('\t');
+
+        if( mFileType == FileTypeNode ) {
+            NodeSelection::Intervals nodes;
+            if( dataLine.count() == 2 ) {
+                nodes = intervals( dataLine.at(0) );
+                foreach( const auto & interval, nodes ) {
+                    implicitNode = qMax(implicitNode, interval.second);
+                }
+                mStatistics.explicitLines++;
+            } else {
+                implicitNode++;
+                nodes << qMakePair(implicitNode, implicitNode);
+                mStatistics.implicitLines++;
+            }
+            if( mSelection.isPast( nodes.first().first ) ) {
+                break;
+            }
+            nodes = clip(nodes);
+            if( nodes.isEmpty() ) {
+                continue;
+            }
+            mStatistics.rowCount += intervalsSize(nodes);
+            coverNodes(nodes);
+            addValue( dataLine.last() );
+        } else if( mFileType == FileTypeEdge ) {
+            if( line.isEmpty() ) {
+                break;
+            }
+            NodeSelection::Intervals froms, tos;
+            QByteArray value;
+            if( dataLine.count() == 3 || ( dataLine.count() == 2 && !mHasEdgeValues ) ) {
+                froms = intervals( dataLine.at(0) );
+                tos = intervals( dataLine.at(1) );
+                foreach( const auto & interval, froms ) {
+                    implicitNode = qMax(implicitNode, interval.second);
+                }
+                if( dataLine.count() == 3 ) {
+                    value = dataLine.at(2);
+                }
+                mStatistics.explicitLines++;
+            } else {
+                implicitNode++;
+                froms << qMakePair(implicitNode, implicitNode);
+                tos = intervals( dataLine.at(0) );
+                if( dataLine.count() == 2 ) {
+                    value = dataLine.at(1);
+                }
+                mStatistics.implicitLines++;
+            }
+            if( mSelection.isPast( froms.first().first ) ) {
+                break;
+            }
+            froms = clip(froms);
+            tos = clip(tos);
+            if( froms.isEmpty() || tos.isEmpty() ) {
+                continue;
+            }
+            mStatistics.rowCount += intervalsSize(froms) * intervalsSize(tos);
+            coverNodes(froms);
+            addValue(value);
+        }
+    }
+
+    mStatistics.distinctValues = distinct.estimate();
+}
+
 void TFFile::addDataToDatabase(AbstractDatabaseAdapter *db)
 {
+    /// the parser kernels read node and edge files themselves
+    if( mFileType == FileTypeNode ) {
+        addNodesToDatabase(db);
+        return;
+    }
+    if( mFileType == FileTypeEdge && !db->storesEdgeRanges() ) {
+        addEdgesToDatabase(db);
+        return;
+    }
+
     QFile file(mInfo.absoluteFilePath());
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
     {
@@ -56,71 +323,214 @@ void TFFile::addDataToDatabase(AbstractDatabaseAdapter *db)
     QTextStream * stream = new QTextStream(&file);
     stream->setCodec("UTF-8");
 
-    switch(mFileType)
-    {
-    case FileTypeNode:
-        addNodesToDatabase(db, stream);
-        break;
-    case FileTypeEdge:
-        addEdgesToDatabase(db, stream);
-        break;
-    case FileTypeConfig:
+    if( mFileType == FileTypeEdge ) {
+        addEdgeRangesToDatabase(db, stream);
+    } else {
         addConfigToDatabase(db, stream);
-        break;
     }
 
     delete stream;
 }
 
-void TFFile::addNodesToDatabase(AbstractDatabaseAdapter *db, QTextStream * stream)
-{    
-    skipOverHeader(stream);
+void TFFile::readNodes(QVariantList &ids, QVariantList &values)
+{
+    readNodes( [&](unsigned int node, const QString & value) {
+        ids << node;
+        values << value;
+    } );
+}
 
-    unsigned int implicitNode = 0;
+void TFFile::readEdges(QVariantList &froms, QVariantList &tos, QVariantList &values)
+{
+    readEdges( [&](unsigned int from, unsigned int to, const QString & value) {
+        froms << from;
+        tos << to;
+        values << value;
+    } );
+}
+
+void TFFile::readNodes(const NodeCallback &callback)
+{
+    QFile file(mInfo.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qCritical() << "File could not be opened: " << mInfo.absoluteFilePath();
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    readNodes(&stream, callback);
+}
+
+void TFFile::readEdges(const EdgeCallback &callback)
+{
+    QFile file(mInfo.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qCritical() << "File could not be opened: " << mInfo.absoluteFilePath();
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    readEdges(&stream, callback);
+}
 
+bool TFFile::canParseRowsFor(const AbstractDatabaseAdapter *db) const
+{
+    if( mFileType == FileTypeNode ) {
+        return true;
+    }
+    /// sorted edges stream into the sorter, and edge ranges aren't expanded
+    return mFileType == FileTypeEdge && !db->storesEdgeRanges() && !db->sortsEdges();
+}
+
+void TFFile::parseRows()
+{
+    mParsedNodes.clear();
+    mParsedTos.clear();
+    mParsedValues.clear();
+    mParsedNodes.reserve( static_cast<int>(mStatistics.rowCount) );
+    mParsedValues.reserve( static_cast<int>(mStatistics.rowCount) );
+
+    /// the kernel for this file's shape reads the bytes directly
+    if( mFileType == FileTypeNode ) {
+        TFParser::parseNodes( *this, [&](unsigned int node, const QVariant & value) {
+            mParsedNodes << node;
+            mParsedValues << value;
+        } );
+    } else if( mFileType == FileTypeEdge ) {
+        mParsedTos.reserve( static_cast<int>(mStatistics.rowCount) );
+        TFParser::parseEdges( *this, [&](unsigned int from, unsigned int to, const QVariant & value) {
+            mParsedNodes << from;
+            mParsedTos << to;
+            mParsedValues << value;
+        } );
+    }
+    mRowsParsed = true;
+}
+
+void TFFile::addNodesToDatabase(AbstractDatabaseAdapter *db)
+{
     const QString column = label();
-    const QString columnType = db->sqlDataType( mValueType );
+    const QString columnType = db->sqlDataType( mValueType, mStatistics );
+
+    if( !mRowsParsed ) {
+        parseRows();
+    }
+    db->insertNodeData( column, columnType, mParsedNodes, mParsedValues );
+
+    mParsedNodes.clear();
+    mParsedValues.clear();
+    mRowsParsed = false;
+}
+
+void TFFile::readNodes(QTextStream *stream, const NodeCallback &callback)
+{
+    skipOverHeader(stream);
 
-    QVariantList ids;
-    QVariantList values;
+    unsigned int implicitNode = 0;
 
     while (!stream->atEnd()) {
         const QString line = stream->readLine();
         const QStringList dataLine = line.split("\t"); /// it might be tab-delimited
         if( dataLine.count() == 2 ) { /// if it is tab delimited, the first thing is the node number, the second is the data
-            const QSet<unsigned int> nodeSet = nodeRangeToSet( dataLine.at(0) );
+            /// intervals come back sorted, so nodes are passed on in ascending order
+            const Intervals allNodes = nodeRangeToIntervals( dataLine.at(0) );
+            implicitNode = allNodes.last().second;
+            if( mSelection.isPast( allNodes.first().first ) ) {
+                break;
+            }
+            const Intervals nodes = mSelection.clip( allNodes );
+            if( nodes.isEmpty() ) {
+                continue;
+            }
             const QString value = unescape(dataLine.at(1));
-            implicitNode = max(nodeSet);
-            QSetIterator<unsigned int> i(nodeSet);
-            while(i.hasNext()) {
-                ids << i.next();
-                values << value;
+            foreach( const Interval & interval, nodes ) {
+                for(unsigned int node = interval.first; node <= interval.second; node++) {
+                    callback( node, value );
+                }
             }
         } else if( dataLine.count() == 1 ) {
             implicitNode++;
+            if( mSelection.isPast( implicitNode ) ) {
+                break;
+            }
+            if( !mSelection.contains( implicitNode ) ) {
+                continue;
+            }
             const QString value = unescape(dataLine.at(0));
-            ids << implicitNode;
-            values << value;
+            callback( implicitNode, value );
         } else {
             qCritical() << "Data line count error: " << dataLine.count();
         }
     }
+}
 
-    db->insertNodeData( column, columnType, ids, values );
+void TFFile::addEdgesToDatabase(AbstractDatabaseAdapter *db)
+{
+    if( db->sortsEdges() ) {
+        ExternalEdgeSorter sorter( db->edgeSortKey(), db->edgeSortMemory() );
+        TFParser::parseEdges( *this, [&](unsigned int from, unsigned int to, const QVariant & value) {
+            sorter.add(from, to, value);
+        } );
+        if( sorter.runCount() > 0 ) {
+            qDebug() << "Merging" << sorter.runCount() << "sorted runs for" << label();
+        }
+        sorter.finish( [&](const QVariantList & froms, const QVariantList & tos, const QVariantList & values) {
+            db->insertEdgeData(label(), froms, tos, values);
+        }, qMax( db->batchSize(), 100000 ) );
+        return;
+    }
+
+    if( !mRowsParsed ) {
+        parseRows();
+    }
+    db->insertEdgeData(label(), mParsedNodes, mParsedTos, mParsedValues);
+
+    mParsedNodes.clear();
+    mParsedTos.clear();
+    mParsedValues.clear();
+    mRowsParsed = false;
 }
 
-void TFFile::addEdgesToDatabase(AbstractDatabaseAdapter *db, QTextStream * stream)
+void TFFile::addEdgeRangesToDatabase(AbstractDatabaseAdapter *db, QTextStream *stream)
+{
+    QVariantList fromStarts, fromEnds, toStarts, toEnds, values;
+    readEdgeRanges(stream, [&](const Intervals & froms, const Intervals & tos, const QString & value) {
+        foreach( const Interval & from, froms ) {
+            foreach( const Interval & to, tos ) {
+                fromStarts << from.first;
+                fromEnds << from.second;
+                toStarts << to.first;
+                toEnds << to.second;
+                values << value;
+            }
+        }
+    } );
+
+    db->insertEdgeRanges(label(), fromStarts, fromEnds, toStarts, toEnds, values);
+}
+
+void TFFile::readEdges(QTextStream *stream, const EdgeCallback &callback)
+{
+    readEdgeRanges(stream, [&](const Intervals & froms, const Intervals & tos, const QString & value) {
+        foreach( const Interval & from, froms ) {
+            for(unsigned int f = from.first; f <= from.second; f++) {
+                foreach( const Interval & to, tos ) {
+                    for(unsigned int t = to.first; t <= to.second; t++) {
+                        callback( f, t, value );
+                    }
+                }
+            }
+        }
+    } );
+}
+
+void TFFile::readEdgeRanges(QTextStream *stream, const EdgeRangeCallback &callback)
 {
-    Q_UNUSED(db)
     skipOverHeader(stream);
 
     unsigned int implicitNode = 0;
 
-    QVariantList froms;
-    QVariantList tos;
-    QVariantList values;
-
-    QSet<unsigned int> from_index, to_index;
+    Intervals from_index, to_index;
     while (!stream->atEnd()) {
         const QString line = stream->readLine();
         if(line.isEmpty()) {
@@ -129,48 +539,45 @@ void TFFile::addEdgesToDatabase(AbstractDatabaseAdapter *db, QTextStream * strea
             QString value;
             QStringList dataLine = line.split("\t");
             if( dataLine.count() == 3 ) {
-                from_index = nodeRangeToSet( dataLine.at(0) );
-                to_index = nodeRangeToSet( dataLine.at(1) );
+                from_index = nodeRangeToIntervals( dataLine.at(0) );
+                to_index = nodeRangeToIntervals( dataLine.at(1) );
                 value = unescape(dataLine.at(2));
-                implicitNode = max(from_index);
+                implicitNode = from_index.last().second;
             } else if( dataLine.count() == 2 ) {
                 // check the first node anyway
                 if( mHasEdgeValues ) {
                     implicitNode++;
                     from_index.clear();
-                    from_index << implicitNode;
-                    to_index = nodeRangeToSet( dataLine.at(0) );
+                    from_index << Interval(implicitNode, implicitNode);
+                    to_index = nodeRangeToIntervals( dataLine.at(0) );
                     value = unescape(dataLine.at(1));
                 } else {
                     // check the second node only if there are no values and this node should be interpreted as a node
-                    from_index = nodeRangeToSet( dataLine.at(0));
-                    to_index = nodeRangeToSet(dataLine.at(1));
+                    from_index = nodeRangeToIntervals( dataLine.at(0));
+                    to_index = nodeRangeToIntervals(dataLine.at(1));
                     value = "";
-                    implicitNode = max(from_index);
+                    implicitNode = from_index.last().second;
                 }
             } else if( dataLine.count() == 1 ) {
                 implicitNode++;
                 from_index.clear();
-                from_index << implicitNode;
-                to_index = nodeRangeToSet(dataLine.at(0));
+                from_index << Interval(implicitNode, implicitNode);
+                to_index = nodeRangeToIntervals(dataLine.at(0));
                 value = "";
             } else {
                 qCritical() << "Edge line count error: " << dataLine.count();
             }
 
-            QSetIterator<unsigned int> i(from_index);
-            while(i.hasNext()) {
-                unsigned int current_i = i.next();
-                QSetIterator<unsigned int> j(to_index);
-                while(j.hasNext()) {
-                    froms << current_i;
-                    tos << j.next();
-                    values << value;
-                }
+            if( !from_index.isEmpty() && mSelection.isPast( from_index.first().first ) ) {
+                break;
+            }
+            const Intervals froms = mSelection.clip( from_index );
+            const Intervals tos = mSelection.clip( to_index );
+            if( !froms.isEmpty() && !tos.isEmpty() ) {
+                callback( froms, tos, value );
             }
         }
     }
-    db->insertEdgeData(label(), froms, tos, values);
 }
 
 void TFFile::addConfigToDatabase(AbstractDatabaseAdapter *db, QTextStream * stream)
@@ -180,19 +587,6 @@ void TFFile::addConfigToDatabase(AbstractDatabaseAdapter *db, QTextStream * stre
     /// TODO: ?
 }
 
-unsigned int TFFile::max(QSet<unsigned int> set)
-{
-    unsigned int max = 0;
-    QSetIterator<unsigned int> i(set);
-    while( i.hasNext() ) {
-        unsigned int thisOne = i.next();
-        if( thisOne > max ) {
-            max = thisOne;
-        }
-    }
-    return max;
-}
-
 QString TFFile::unescape(QString string)
 {
     // vaguely cheating...
@@ -204,24 +598,15 @@ QString TFFile::unescape(QString string)
     return str;
 }
 
-QSet<unsigned int> TFFile::nodeRangeToSet(const QString &range)
-{
-    /*
-     * Testing
-        qDebug() << nodeRangeToSet("45");
-        qDebug() << nodeRangeToSet("5-13");
-        qDebug() << nodeRangeToSet("1-3,5-10,15,23-37");
-        qDebug() << nodeRangeToSet("1-5,2-7");
-        qDebug() << nodeRangeToSet("3-1");
-    */
-    QSet<unsigned int> set;
-    QStringList ranges = range.split(",");
-    foreach(QString range, ranges) {
-        QStringList pairString = range.split("-");
-        QPair<unsigned int,unsigned int> pair(0,0);
+TFFile::Intervals TFFile::nodeRangeToIntervals(const QString &range)
+{
+    Intervals intervals;
+    foreach(QString part, range.split(",")) {
+        QStringList pairString = part.split("-");
+        Interval pair(0,0);
         if(pairString.count() == 1) {
             pair.first = pairString.at(0).toUInt();
-            pair.second = pairString.at(0).toUInt();
+            pair.second = pair.first;
         } else if(pairString.count() == 2) {
             pair.first = pairString.at(0).toUInt();
             pair.second = pairString.at(1).toUInt();
@@ -229,16 +614,41 @@ QSet<unsigned int> TFFile::nodeRangeToSet(const QString &range)
             qCritical() << "Error in pair format.";
         }
         if( pair.first > pair.second ) {
-            unsigned int temp;
-            temp = pair.first;
-            pair.first = pair.second;
-            pair.second = temp;
-        }
-        for(unsigned int i=pair.first; i<=pair.second; i++) {
-            set << i;
+            qSwap(pair.first, pair.second);
         }
+        intervals << pair;
     }
-    return set;
+
+    /// sort and merge, so that 1-5,2-7 comes out as 1-7
+    return NodeSelection::normalized(intervals);
+}
+
+QHash<QString, QPair<unsigned int, unsigned int> > TFFile::readOTypeRanges(const QString &path)
+{
+    QHash<QString,QPair<unsigned int,unsigned int>> oTypeRanges;
+    QFile file( path );
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qWarning() << "File could not be opened: " << path;
+    }
+
+    QTextStream in(&file);
+
+    // skip past header
+    QString ln;
+    do {
+        ln = in.readLine();
+    } while( ln.length() > 0 && ln.at(0) == "@" );
+
+    QRegExp rx("^(.*)-(.*)\t(.*)$");
+    do {
+        ln = in.readLine();
+        int pos = rx.indexIn(ln);
+        if (pos > -1) {
+            oTypeRanges[ rx.cap(3) ] = QPair<unsigned int,unsigned int>( rx.cap(1).toUInt(), rx.cap(2).toUInt() );
+        }
+    } while( !in.atEnd() );
+    return oTypeRanges;
 }
 
 TFFile::FileType TFFile::fileTypeFromString(const QString &str)
@@ -4,6 +4,14 @@
 #include <QString>
 #include <QFileInfo>
 #include <QTextStream>
+#include <QVariantList>
+#include <QSet>
+#include <QHash>
+#include <QPair>
+
+#include <functional>
+
+#include "nodeselection.h"
 
 class Reader;
 class AbstractDatabaseAdapter;
@@ -15,6 +23,36 @@ public:
     enum ValueType { ValueTypeString, ValueTypeInteger };
     enum FileType { FileTypeNode, FileTypeEdge, FileTypeConfig };
 
+    /// what a quick first pass over the file found
+    struct Statistics {
+        Statistics();
+
+        /// node-value pairs, or edges after ranges are expanded
+        qint64 rowCount;
+        /// otypes of the nodes (or edge from-nodes) in the file
+        QSet<QString> otypes;
+        /// an estimate of the number of distinct values
+        int distinctValues;
+        /// only meaningful if hasIntegers
+        bool hasIntegers;
+        qint64 minimumInteger;
+        qint64 maximumInteger;
+        /// in characters, before unescaping
+        int maximumStringLength;
+        /// lines that start with their (from-)node, and lines that leave it implicit
+        qint64 explicitLines;
+        qint64 implicitLines;
+    };
+
+    /// an inclusive range of node numbers
+    typedef QPair<unsigned int, unsigned int> Interval;
+    typedef QList<Interval> Intervals;
+
+    typedef std::function<void(unsigned int node, const QString & value)> NodeCallback;
+    typedef std::function<void(unsigned int from, unsigned int to, const QString & value)> EdgeCallback;
+    /// one line of an edge file: every from-node is joined to every to-node
+    typedef std::function<void(const Intervals & froms, const Intervals & tos, const QString & value)> EdgeRangeCallback;
+
     explicit TFFile(const QFileInfo & info);
     ~TFFile();
 
@@ -22,24 +60,61 @@ public:
 
     FileType fileType() const;
     ValueType valueType() const;
+    /// edge files only: whether lines carry a value
+    bool hasEdgeValues() const;
 
     /// filename minus the extension
     QString label() const;
 
     void addDataToDatabase( AbstractDatabaseAdapter * db );
 
-    static unsigned int max(QSet<unsigned int> set);
+    /// whether addDataToDatabase(@db) inserts rows that parseRows() can prepare
+    bool canParseRowsFor( const AbstractDatabaseAdapter * db ) const;
+    /// parse the rows into memory ahead of addDataToDatabase, which then only
+    /// inserts them; this touches nothing shared, so files can be parsed in parallel
+    void parseRows();
+
+    /// parse a node file into parallel lists of node ids and values
+    void readNodes( QVariantList & ids, QVariantList & values );
+    /// parse an edge file into parallel lists of from-nodes, to-nodes and values
+    void readEdges( QVariantList & froms, QVariantList & tos, QVariantList & values );
+
+    /// a fast pass over the file that fills in statistics() without expanding node ranges
+    void scanStatistics( const QHash<QString,QPair<unsigned int,unsigned int>> & oTypeRanges );
+    const Statistics & statistics() const;
+
+    /// stream the file through @callback, one node (or edge) at a time
+    void readNodes( const NodeCallback & callback );
+    void readEdges( const EdgeCallback & callback );
+    /// stream an edge file through @callback one line at a time, without expanding ranges
+    void readEdgeRanges( const EdgeRangeCallback & callback );
+
+    /// Only nodes in @selection are read (or counted by scanStatistics); an edge
+    /// is read if both of its ends are. TF files list nodes in ascending order,
+    /// so reading stops at the first line beyond the selection.
+    void setSelection( const NodeSelection & selection );
+    const NodeSelection & selection() const;
+
     static QString unescape(QString string);
-    static QSet<unsigned int> nodeRangeToSet(const QString & range);
+    /// sorted, with overlapping and adjacent ranges merged
+    static Intervals nodeRangeToIntervals(const QString & range);
+
+    /// the node range of each otype in otype.tf at @path
+    static QHash<QString,QPair<unsigned int,unsigned int>> readOTypeRanges(const QString & path);
 
     static FileType fileTypeFromString(const QString & str);
     static ValueType valueTypeFromString(const QString & str);
 
 private:
-    void addNodesToDatabase(AbstractDatabaseAdapter * db, QTextStream * stream );
-    void addEdgesToDatabase(AbstractDatabaseAdapter *db, QTextStream * stream );
+    void addNodesToDatabase(AbstractDatabaseAdapter * db );
+    void addEdgesToDatabase(AbstractDatabaseAdapter *db );
+    void addEdgeRangesToDatabase(AbstractDatabaseAdapter *db, QTextStream * stream );
     void addConfigToDatabase(AbstractDatabaseAdapter * db, QTextStream * stream );
 
+    void readNodes(QTextStream * stream, const NodeCallback & callback );
+    void readEdges(QTextStream * stream, const EdgeCallback & callback );
+    void readEdgeRanges(QTextStream * stream, const EdgeRangeCallback & callback );
+
     /// read the first line of the file (@node, @edge) and return the string
     FileType readFileType(QTextStream *stream);
 
@@ -55,6 +130,14 @@ private:
     FileType mFileType;
     ValueType mValueType;
     bool mHasEdgeValues;
+    Statistics mStatistics;
+    NodeSelection mSelection;
+
+    /// filled by parseRows, and released once inserted
+    bool mRowsParsed;
+    QVariantList mParsedNodes;
+    QVariantList mParsedTos;
+    QVariantList mParsedValues;
 };
 
 QDebug operator<<(QDebug dbg, const TFFile &key);
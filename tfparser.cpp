@@ -0,0 +1,192 @@
+#include "tfparser.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+
+TFParser::FileData::FileData(const QString &path) :
+    mFile(path),
+    mMapped(nullptr),
+    mData(nullptr),
+    mSize(0)
+{
+    if( !mFile.open(QIODevice::ReadOnly) ) {
+        qCritical() << "File could not be opened: " << path;
+        return;
+    }
+    mSize = mFile.size();
+    if( mSize > 0 ) {
+        mMapped = mFile.map(0, mSize);
+    }
+    if( mMapped != nullptr ) {
+        mData = reinterpret_cast<const char*>(mMapped);
+    } else {
+        /// some file systems can't be mapped
+        mBuffer = mFile.readAll();
+        mData = mBuffer.constData();
+        mSize = mBuffer.size();
+    }
+}
+
+TFParser::FileData::~FileData()
+{
+    if( mMapped != nullptr ) {
+        mFile.unmap(mMapped);
+    }
+}
+
+bool TFParser::FileData::isValid() const
+{
+    return mData != nullptr;
+}
+
+const char *TFParser::FileData::begin() const
+{
+    return mData;
+}
+
+const char *TFParser::FileData::end() const
+{
+    return mData + mSize;
+}
+
+TFParser::NodeColumn TFParser::nodeColumn(const TFFile::Statistics &statistics)
+{
+    if( statistics.explicitLines > 0 && statistics.implicitLines == 0 ) {
+        return NodeColumnExplicit;
+    } else if( statistics.implicitLines > 0 && statistics.explicitLines == 0 ) {
+        return NodeColumnImplicit;
+    }
+    return NodeColumnMixed;
+}
+
+QString TFParser::kernelName(const TFFile &file)
+{
+    QStringList parts;
+    parts << ( file.fileType() == TFFile::FileTypeEdge ? "edge" : "node" );
+    parts << ( file.valueType() == TFFile::ValueTypeInteger ? "int" : "str" );
+    if( file.fileType() == TFFile::FileTypeEdge ) {
+        parts << ( file.hasEdgeValues() ? "values" : "novalues" );
+    }
+    switch( nodeColumn( file.statistics() ) ) {
+    case NodeColumnImplicit:
+        parts << "implicit";
+        break;
+    case NodeColumnExplicit:
+        parts << "explicit";
+        break;
+    case NodeColumnMixed:
+        parts << "mixed";
+        break;
+    }
+    return parts.join("/");
+}
+
+const char *TFParser::skipHeader(const char *p, const char *end)
+{
+    const char * next = p;
+    do {
+        p = next;
+        lineEnd(p, end, &next);
+    } while( p < end && *p == '@' );
+    return next;
+}
+
+void TFParser::parseIntervals(const char *begin, const char *end, NodeSelection::Intervals &intervals)
+{
+    intervals.clear();
+    bool normal = true;
+    forever {
+        const char * comma = static_cast<const char*>( std::memchr(begin, ',', static_cast<size_t>(end - begin)) );
+        if( comma == nullptr ) {
+            comma = end;
+        }
+        const char * dash = static_cast<const char*>( std::memchr(begin, '-', static_cast<size_t>(comma - begin)) );
+
+        NodeSelection::Interval interval(0, 0);
+        std::from_chars( begin, dash == nullptr ? comma : dash, interval.first );
+        interval.second = interval.first;
+        if( dash != nullptr ) {
+            std::from_chars( dash + 1, comma, interval.second );
+        }
+        if( interval.first > interval.second ) {
+            qSwap(interval.first, interval.second);
+        }
+        /// out of order, overlapping or adjacent ranges need merging
+        if( !intervals.isEmpty() && static_cast<qulonglong>(interval.first) <= static_cast<qulonglong>(intervals.last().second) + 1 ) {
+            normal = false;
+        }
+        intervals << interval;
+
+        if( comma == end ) {
+            break;
+        }
+        begin = comma + 1;
+    }
+    if( !normal ) {
+        intervals = NodeSelection::normalized(intervals);
+    }
+}
+
+QVariant TFParser::parseString(const char *begin, const char *end)
+{
+    const int length = static_cast<int>(end - begin);
+    const QString value = QString::fromUtf8(begin, length);
+    if( std::memchr(begin, '\\', static_cast<size_t>(length)) != nullptr ) {
+        return TFFile::unescape(value);
+    }
+    return value;
+}
+
+void TFParser::benchmark(const QString &folderPath)
+{
+    const QDir folder(folderPath);
+    const QHash<QString,QPair<unsigned int,unsigned int>> oTypeRanges = TFFile::readOTypeRanges( folder.absoluteFilePath("otype.tf") );
+
+    qint64 totalBytes = 0;
+    qint64 totalGeneral = 0;
+    qint64 totalSpecialized = 0;
+    foreach( QFileInfo info, folder.entryInfoList(QStringList("*.tf"), QDir::Files) ) {
+        TFFile file(info);
+        if( file.fileType() == TFFile::FileTypeConfig ) {
+            continue;
+        }
+        file.scanStatistics(oTypeRanges);
+
+        QElapsedTimer timer;
+        qint64 generalRows = 0;
+        qint64 specializedRows = 0;
+        timer.start();
+        if( file.fileType() == TFFile::FileTypeNode ) {
+            file.readNodes( [&](unsigned int, const QString &) { generalRows++; } );
+        } else {
+            file.readEdges( [&](unsigned int, unsigned int, const QString &) { generalRows++; } );
+        }
+        const qint64 general = timer.nsecsElapsed();
+        timer.restart();
+        if( file.fileType() == TFFile::FileTypeNode ) {
+            parseNodes( file, [&](unsigned int, const QVariant &) { specializedRows++; } );
+        } else {
+            parseEdges( file, [&](unsigned int, unsigned int, const QVariant &) { specializedRows++; } );
+        }
+        const qint64 specialized = timer.nsecsElapsed();
+
+        if( generalRows != specializedRows ) {
+            qWarning() << "TFParser::benchmark" << info.fileName() << "general parser read" << generalRows << "rows, the kernel" << specializedRows;
+        }
+        /// a thousand times bytes per nanosecond is MB/s
+        qInfo().noquote() << QString("%1 %2 %3 rows, general %4 MB/s, specialized %5 MB/s")
+                             .arg( info.fileName(), -24 )
+                             .arg( kernelName(file), -28 )
+                             .arg( specializedRows )
+                             .arg( 1000.0 * info.size() / qMax(general, Q_INT64_C(1)), 0, 'f', 1 )
+                             .arg( 1000.0 * info.size() / qMax(specialized, Q_INT64_C(1)), 0, 'f', 1 );
+        totalBytes += info.size();
+        totalGeneral += general;
+        totalSpecialized += specialized;
+    }
+    qInfo().noquote() << QString("Total: %1 MB, general %2 MB/s, specialized %3 MB/s")
+                         .arg( totalBytes / 1e6, 0, 'f', 1 )
+                         .arg( 1000.0 * totalBytes / qMax(totalGeneral, Q_INT64_C(1)), 0, 'f', 1 )
+                         .arg( 1000.0 * totalBytes / qMax(totalSpecialized, Q_INT64_C(1)), 0, 'f', 1 );
+}
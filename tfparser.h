@@ -0,0 +1,334 @@
+#ifndef TFPARSER_H
+#define TFPARSER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVariant>
+
+#include <charconv>
+#include <cstring>
+
+#include "nodeselection.h"
+#include "tffile.h"
+
+/// Fast parsers for the body of a TF file. The shape of a file (node or edge,
+/// string or integer values, edge values or not, and whether lines start with
+/// their node) is fixed before the first line, so each shape gets its own
+/// kernel, instantiated from a template, that reads the raw bytes with no
+/// per-line tests of the shape. Values come out as QVariants ready for
+/// binding: qlonglong for integer features (null where a node's value is
+/// empty, '' where an edge's is), QString otherwise.
+class TFParser
+{
+public:
+    /// whether lines carry their (from-)node: never, always, or some of them
+    enum NodeColumn { NodeColumnImplicit, NodeColumnExplicit, NodeColumnMixed };
+
+    /// the bytes of a file, mapped into memory where that works
+    class FileData {
+    public:
+        explicit FileData(const QString & path);
+        ~FileData();
+        bool isValid() const;
+        const char * begin() const;
+        const char * end() const;
+    private:
+        QFile mFile;
+        QByteArray mBuffer;
+        uchar * mMapped;
+        const char * mData;
+        qint64 mSize;
+    };
+
+    /// from the line counts of TFFile::scanStatistics; mixed if the file wasn't scanned
+    static NodeColumn nodeColumn(const TFFile::Statistics & statistics);
+    /// e.g., "edge/int/values/explicit"
+    static QString kernelName(const TFFile & file);
+
+    /// @sink(unsigned int node, const QVariant & value), for every selected node of a node file
+    template<typename Sink> static void parseNodes(const TFFile & file, Sink && sink);
+    /// @sink(unsigned int from, unsigned int to, const QVariant & value), for every selected edge of an edge file
+    template<typename Sink> static void parseEdges(const TFFile & file, Sink && sink);
+
+    /// parse every file in @folderPath with its kernel and with TFFile's general
+    /// parser, and print how long each took
+    static void benchmark(const QString & folderPath);
+
+private:
+    template<TFFile::ValueType V, NodeColumn C, typename Sink>
+    static void nodeKernel(const char * p, const char * end, const NodeSelection & selection, Sink & sink);
+    template<TFFile::ValueType V, bool EdgeValues, NodeColumn C, typename Sink>
+    static void edgeKernel(const char * p, const char * end, const NodeSelection & selection, Sink & sink);
+    template<TFFile::ValueType V, bool EdgeValues, typename Sink>
+    static void dispatchEdges(NodeColumn column, const char * p, const char * end, const NodeSelection & selection, Sink & sink);
+
+    /// past the @ lines and the line that ends them, as TFFile::skipOverHeader does
+    static const char * skipHeader(const char * p, const char * end);
+    /// the end of the line at @p, without its \n or \r\n
+    static const char * lineEnd(const char * p, const char * end, const char ** next);
+    static const char * findTab(const char * begin, const char * end);
+    /// a node range like 1-3,5; sorted and merged if there are several
+    static void parseIntervals(const char * begin, const char * end, NodeSelection::Intervals & intervals);
+    static QVariant parseString(const char * begin, const char * end);
+    template<TFFile::ValueType V>
+    static QVariant parseValue(const char * begin, const char * end);
+    /// an edge without a value gets an empty string, as edge tables always have
+    /// (the sorted edge tables of SQLite key on the value, so it can't be NULL)
+    template<TFFile::ValueType V>
+    static QVariant parseEdgeValue(const char * begin, const char * end);
+};
+
+inline const char *TFParser::lineEnd(const char *p, const char *end, const char **next)
+{
+    const char * eol = static_cast<const char*>( std::memchr(p, '\n', static_cast<size_t>(end - p)) );
+    if( eol == nullptr ) {
+        eol = end;
+        *next = end;
+    } else {
+        *next = eol + 1;
+    }
+    if( eol > p && eol[-1] == '\r' ) {
+        eol--;
+    }
+    return eol;
+}
+
+inline const char *TFParser::findTab(const char *begin, const char *end)
+{
+    return static_cast<const char*>( std::memchr(begin, '\t', static_cast<size_t>(end - begin)) );
+}
+
+template<TFFile::ValueType V>
+QVariant TFParser::parseValue(const char *begin, const char *end)
+{
+    if constexpr ( V == TFFile::ValueTypeInteger ) {
+        if( begin == end ) {
+            return QVariant();
+        }
+        qlonglong number = 0;
+        const std::from_chars_result result = std::from_chars(begin, end, number);
+        if( result.ec == std::errc() && result.ptr == end ) {
+            return QVariant(number);
+        }
+        /// not a number after all; keep it as it is
+        return parseString(begin, end);
+    } else {
+        return parseString(begin, end);
+    }
+}
+
+template<TFFile::ValueType V>
+QVariant TFParser::parseEdgeValue(const char *begin, const char *end)
+{
+    if( begin == end ) {
+        return QVariant( QString("") );
+    }
+    return parseValue<V>(begin, end);
+}
+
+template<TFFile::ValueType V, TFParser::NodeColumn C, typename Sink>
+void TFParser::nodeKernel(const char *p, const char *end, const NodeSelection &selection, Sink &sink)
+{
+    const bool everything = selection.isEverything();
+    unsigned int implicitNode = 0;
+    NodeSelection::Intervals nodes;
+    const char * next = p;
+    for( ; p < end; p = next ) {
+        const char * last = lineEnd(p, end, &next);
+
+        const char * tab = nullptr;
+        bool hasNodeColumn;
+        if constexpr ( C == NodeColumnExplicit ) {
+            tab = findTab(p, last);
+            hasNodeColumn = true;
+        } else if constexpr ( C == NodeColumnImplicit ) {
+            hasNodeColumn = false;
+        } else {
+            tab = findTab(p, last);
+            hasNodeColumn = tab != nullptr;
+        }
+
+        if( !hasNodeColumn ) {
+            implicitNode++;
+            if( !everything ) {
+                if( selection.isPast(implicitNode) ) {
+                    break;
+                }
+                if( !selection.contains(implicitNode) ) {
+                    continue;
+                }
+            }
+            sink( implicitNode, parseValue<V>(p, last) );
+            continue;
+        }
+
+        const char * valueBegin = tab == nullptr ? last : tab + 1;
+        parseIntervals( p, tab == nullptr ? last : tab, nodes );
+        implicitNode = nodes.last().second;
+        if( !everything ) {
+            if( selection.isPast( nodes.first().first ) ) {
+                break;
+            }
+            nodes = selection.clip(nodes);
+            if( nodes.isEmpty() ) {
+                continue;
+            }
+        }
+        const QVariant value = parseValue<V>(valueBegin, last);
+        for(const NodeSelection::Interval & interval : nodes) {
+            for(unsigned int node = interval.first; node <= interval.second; node++) {
+                sink( node, value );
+            }
+        }
+    }
+}
+
+template<TFFile::ValueType V, bool EdgeValues, TFParser::NodeColumn C, typename Sink>
+void TFParser::edgeKernel(const char *p, const char *end, const NodeSelection &selection, Sink &sink)
+{
+    const bool everything = selection.isEverything();
+    unsigned int implicitNode = 0;
+    NodeSelection::Intervals froms, tos;
+    const char * next = p;
+    for( ; p < end; p = next ) {
+        const char * last = lineEnd(p, end, &next);
+        if( last == p ) {
+            break;
+        }
+
+        const char * tab = findTab(p, last);
+        bool hasFromColumn;
+        if constexpr ( C == NodeColumnExplicit ) {
+            hasFromColumn = true;
+        } else if constexpr ( C == NodeColumnImplicit ) {
+            hasFromColumn = false;
+        } else if constexpr ( EdgeValues ) {
+            /// with values, only a line of three columns names its from-node
+            hasFromColumn = tab != nullptr && findTab(tab + 1, last) != nullptr;
+        } else {
+            hasFromColumn = tab != nullptr;
+        }
+
+        QVariant value;
+        if( hasFromColumn ) {
+            const char * toBegin = tab == nullptr ? last : tab + 1;
+            const char * valueTab = EdgeValues ? findTab(toBegin, last) : nullptr;
+            parseIntervals( p, tab == nullptr ? last : tab, froms );
+            parseIntervals( toBegin, valueTab == nullptr ? last : valueTab, tos );
+            value = valueTab == nullptr ? QVariant( QString("") ) : parseEdgeValue<V>(valueTab + 1, last);
+            implicitNode = froms.last().second;
+        } else {
+            implicitNode++;
+            froms.clear();
+            froms << NodeSelection::Interval(implicitNode, implicitNode);
+            const char * valueTab = EdgeValues ? tab : nullptr;
+            parseIntervals( p, valueTab == nullptr ? last : valueTab, tos );
+            value = valueTab == nullptr ? QVariant( QString("") ) : parseEdgeValue<V>(valueTab + 1, last);
+        }
+
+        if( !everything ) {
+            if( selection.isPast( froms.first().first ) ) {
+                break;
+            }
+            froms = selection.clip(froms);
+            tos = selection.clip(tos);
+            if( froms.isEmpty() || tos.isEmpty() ) {
+                continue;
+            }
+        }
+        for(const NodeSelection::Interval & from : froms) {
+            for(unsigned int f = from.first; f <= from.second; f++) {
+                for(const NodeSelection::Interval & to : tos) {
+                    for(unsigned int t = to.first; t <= to.second; t++) {
+                        sink( f, t, value );
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<typename Sink>
+void TFParser::parseNodes(const TFFile &file, Sink &&sink)
+{
+    FileData data( file.info().absoluteFilePath() );
+    if( !data.isValid() ) {
+        return;
+    }
+    const char * p = skipHeader( data.begin(), data.end() );
+    const NodeSelection & selection = file.selection();
+
+    switch( file.valueType() ) {
+    case TFFile::ValueTypeInteger:
+        switch( nodeColumn( file.statistics() ) ) {
+        case NodeColumnImplicit:
+            nodeKernel<TFFile::ValueTypeInteger, NodeColumnImplicit>( p, data.end(), selection, sink );
+            break;
+        case NodeColumnExplicit:
+            nodeKernel<TFFile::ValueTypeInteger, NodeColumnExplicit>( p, data.end(), selection, sink );
+            break;
+        case NodeColumnMixed:
+            nodeKernel<TFFile::ValueTypeInteger, NodeColumnMixed>( p, data.end(), selection, sink );
+            break;
+        }
+        break;
+    case TFFile::ValueTypeString:
+        switch( nodeColumn( file.statistics() ) ) {
+        case NodeColumnImplicit:
+            nodeKernel<TFFile::ValueTypeString, NodeColumnImplicit>( p, data.end(), selection, sink );
+            break;
+        case NodeColumnExplicit:
+            nodeKernel<TFFile::ValueTypeString, NodeColumnExplicit>( p, data.end(), selection, sink );
+            break;
+        case NodeColumnMixed:
+            nodeKernel<TFFile::ValueTypeString, NodeColumnMixed>( p, data.end(), selection, sink );
+            break;
+        }
+        break;
+    }
+}
+
+template<TFFile::ValueType V, bool EdgeValues, typename Sink>
+void TFParser::dispatchEdges(NodeColumn column, const char *p, const char *end, const NodeSelection &selection, Sink &sink)
+{
+    switch( column ) {
+    case NodeColumnImplicit:
+        edgeKernel<V, EdgeValues, NodeColumnImplicit>( p, end, selection, sink );
+        break;
+    case NodeColumnExplicit:
+        edgeKernel<V, EdgeValues, NodeColumnExplicit>( p, end, selection, sink );
+        break;
+    case NodeColumnMixed:
+        edgeKernel<V, EdgeValues, NodeColumnMixed>( p, end, selection, sink );
+        break;
+    }
+}
+
+template<typename Sink>
+void TFParser::parseEdges(const TFFile &file, Sink &&sink)
+{
+    FileData data( file.info().absoluteFilePath() );
+    if( !data.isValid() ) {
+        return;
+    }
+    const char * p = skipHeader( data.begin(), data.end() );
+    const NodeSelection & selection = file.selection();
+    const NodeColumn column = nodeColumn( file.statistics() );
+
+    if( file.valueType() == TFFile::ValueTypeInteger ) {
+        if( file.hasEdgeValues() ) {
+            dispatchEdges<TFFile::ValueTypeInteger, true>( column, p, data.end(), selection, sink );
+        } else {
+            dispatchEdges<TFFile::ValueTypeInteger, false>( column, p, data.end(), selection, sink );
+        }
+    } else {
+        if( file.hasEdgeValues() ) {
+            dispatchEdges<TFFile::ValueTypeString, true>( column, p, data.end(), selection, sink );
+        } else {
+            dispatchEdges<TFFile::ValueTypeString, false>( column, p, data.end(), selection, sink );
+        }
+    }
+}
+
+#endif // TFPARSER_H
@@ -0,0 +1,96 @@
+#include "throughputtuner.h"
+
+namespace {
+/// a window is closed once it covers this much time, so that small batches
+/// are still judged on a meaningful sample
+const qint64 MinimumWindowNsecs = 250 * 1000 * 1000;
+/// changes in rate smaller than this are treated as noise
+const double RateTolerance = 0.03;
+}
+
+ThroughputTuner::ThroughputTuner(int initialValue, int minimum, int maximum) :
+    mValue(qBound(minimum, initialValue, maximum)),
+    mMinimum(minimum),
+    mMaximum(maximum),
+    mFixed(false),
+    mSettled(false),
+    mDirection(1),
+    mBestValue(mValue),
+    mBestRate(0),
+    mFailedSteps(0),
+    mWindowRows(0),
+    mWindowNsecs(0)
+{
+}
+
+int ThroughputTuner::value() const
+{
+    return mValue;
+}
+
+void ThroughputTuner::setFixed(int value)
+{
+    mValue = qMax(1, value);
+    mFixed = true;
+}
+
+bool ThroughputTuner::isFixed() const
+{
+    return mFixed;
+}
+
+void ThroughputTuner::record(qint64 rows, qint64 nsecs)
+{
+    if( mFixed || mSettled || rows <= 0 ) {
+        return;
+    }
+
+    mWindowRows += rows;
+    mWindowNsecs += nsecs;
+    if( mWindowNsecs < MinimumWindowNsecs ) {
+        return;
+    }
+
+    const double rate = static_cast<double>(mWindowRows) * 1e9 / static_cast<double>(qMax<qint64>(1, mWindowNsecs));
+    mWindowRows = 0;
+    mWindowNsecs = 0;
+    adjust(rate);
+}
+
+double ThroughputTuner::bestRate() const
+{
+    return mBestRate;
+}
+
+bool ThroughputTuner::isSettled() const
+{
+    return mFixed || mSettled;
+}
+
+void ThroughputTuner::adjust(double rate)
+{
+    if( rate > mBestRate * (1.0 + RateTolerance) ) {
+        /// better: keep going the same way from here
+        mBestRate = rate;
+        mBestValue = mValue;
+        mFailedSteps = 0;
+    } else {
+        /// no better: try the other side of the best value, unless that failed too
+        mFailedSteps++;
+        mDirection = -mDirection;
+    }
+
+    while( mFailedSteps < 2 ) {
+        const int next = qBound(mMinimum, mDirection > 0 ? mBestValue * 2 : mBestValue / 2, mMaximum);
+        if( next != mBestValue ) {
+            mValue = next;
+            return;
+        }
+        /// we are at a bound, so there is nothing to try this way
+        mFailedSteps++;
+        mDirection = -mDirection;
+    }
+
+    mValue = mBestValue;
+    mSettled = true;
+}
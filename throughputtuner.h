@@ -0,0 +1,52 @@
+#ifndef THROUGHPUTTUNER_H
+#define THROUGHPUTTUNER_H
+
+#include <QtGlobal>
+
+/// Hill-climbs a size parameter (rows per batch, rows per commit) toward
+/// the value that gives the best rows per second. Measurements are grouped
+/// into windows so that one slow statement does not send the value off in
+/// the wrong direction. Once a step both ways from the best value fails to
+/// beat it, the tuner goes back to that value and stays there.
+class ThroughputTuner
+{
+public:
+    ThroughputTuner(int initialValue, int minimum, int maximum);
+
+    int value() const;
+
+    /// a fixed tuner never changes its value (used for command-line overrides)
+    void setFixed(int value);
+    bool isFixed() const;
+
+    /// record that @rows rows took @nsecs nanoseconds at the current value
+    void record(qint64 rows, qint64 nsecs);
+
+    /// the best rate seen so far, in rows per second
+    double bestRate() const;
+
+    /// whether the value has stopped changing
+    bool isSettled() const;
+
+private:
+    void adjust(double rate);
+
+    int mValue;
+    int mMinimum;
+    int mMaximum;
+    bool mFixed;
+    bool mSettled;
+
+    /// +1 when growing, -1 when shrinking
+    int mDirection;
+    /// the value that gave mBestRate
+    int mBestValue;
+    double mBestRate;
+    /// steps away from mBestValue that did no better, in a row
+    int mFailedSteps;
+
+    qint64 mWindowRows;
+    qint64 mWindowNsecs;
+};
+
+#endif // THROUGHPUTTUNER_H
@@ -0,0 +1,218 @@
+#include "wordcontext.h"
+
+#include <QtDebug>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <vector>
+
+#include "abstractdatabaseadapter.h"
+#include "parallel.h"
+#include "tffile.h"
+
+WordContext::WordContext(const QDir &folder, AbstractDatabaseAdapter *db, const QHash<QString, QPair<unsigned int, unsigned int> > &oTypeRanges) :
+    mFolder(folder),
+    mDb(db),
+    mOTypeRanges(oTypeRanges),
+    mSlotRange(0, 0)
+{
+    /// the slot type is the one whose nodes come first (word, in the BHSA)
+    bool first = true;
+    QHashIterator<QString,QPair<unsigned int,unsigned int>> i( mOTypeRanges );
+    while (i.hasNext()) {
+        i.next();
+        if( first || i.value().first < mSlotRange.first ) {
+            mSlotType = i.key();
+            mSlotRange = i.value();
+            first = false;
+        }
+    }
+}
+
+void WordContext::setSelection(const NodeSelection &selection)
+{
+    mSelection = selection;
+}
+
+QString WordContext::tableName() const
+{
+    return mSlotType + "_context";
+}
+
+void WordContext::build(const QStringList &requestedLevels)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList levels;
+    foreach( QString level, requestedLevels ) {
+        if( !mOTypeRanges.contains(level) || level == mSlotType ) {
+            qWarning() << "WordContext::build" << "Not a level above the slots:" << level;
+            continue;
+        }
+        levels << level;
+    }
+    if( levels.isEmpty() ) {
+        return;
+    }
+
+    loadSpans(levels);
+
+    /// reach[i] is the furthest slot covered by spans 0..i, which finds the spans
+    /// that start before a chunk but run into it
+    QHash<QString,QVector<unsigned int>> reach;
+    foreach( QString level, levels ) {
+        const QVector<Span> & spans = mSpans[level];
+        QVector<unsigned int> & r = reach[level];
+        r.resize( spans.count() );
+        unsigned int furthest = 0;
+        for(int i = 0; i < spans.count(); i++) {
+            furthest = qMax( furthest, spans.at(i).end );
+            r[i] = furthest;
+        }
+    }
+
+    const int slotCount = static_cast<int>(mSlotRange.second - mSlotRange.first + 1);
+    std::vector<std::vector<unsigned int>> ancestors( levels.count(), std::vector<unsigned int>( slotCount, 0 ) );
+
+    /// each chunk covers its own slots, so the threads never write to the same place
+    const QList<NodeSelection::Interval> bookChunks = chunks();
+    parallelFor( 0, bookChunks.count(), [&](int begin, int end) {
+        for(int c = begin; c < end; c++) {
+            for(int l = 0; l < levels.count(); l++) {
+                const QString & level = levels.at(l);
+                fill( mSpans.constFind(level).value(), reach.constFind(level).value(), ancestors[l], bookChunks.at(c).first, bookChunks.at(c).second );
+            }
+        }
+    } );
+
+    QSet<QString> columns;
+    QHash<QString, QString> columnTypes;
+    columns << "_id";
+    columnTypes["_id"] = mDb->primaryKeyType();
+    foreach( QString level, levels ) {
+        columns << level;
+        columnTypes[level] = mDb->integerTypeForRange( mOTypeRanges.value(level).first, mOTypeRanges.value(level).second );
+    }
+    mDb->createTable( tableName(), columns, columnTypes );
+
+    QVariantList ids;
+    QList<QVariantList> values;
+    for(int l = 0; l < levels.count(); l++) {
+        values << QVariantList();
+    }
+    for(int s = 0; s < slotCount; s++) {
+        const unsigned int slot = mSlotRange.first + static_cast<unsigned int>(s);
+        if( !mSelection.contains(slot) ) {
+            continue;
+        }
+        ids << slot;
+        for(int l = 0; l < levels.count(); l++) {
+            const unsigned int node = ancestors[l][s];
+            values[l] << ( node == 0 ? QVariant() : QVariant(node) );
+        }
+    }
+    mDb->insertRows( tableName(), QStringList() << "_id" << levels, QList<QVariantList>() << ids << values );
+
+    foreach( QString level, levels ) {
+        mDb->createIndex( tableName(), QStringList() << level );
+    }
+
+    qDebug() << "Built" << tableName() << "for" << ids.count() << "slots in" << timer.elapsed() << "milliseconds";
+}
+
+void WordContext::loadSpans(const QStringList &levels)
+{
+    /// levels are otype ranges, so a sorted list of them finds the level of a node
+    QList<QPair<QPair<unsigned int,unsigned int>,QString>> ranges;
+    foreach( QString level, levels ) {
+        ranges << qMakePair( mOTypeRanges.value(level), level );
+    }
+    std::sort( ranges.begin(), ranges.end() );
+
+    TFFile( QFileInfo( mFolder.absoluteFilePath("oslots.tf") ) ).readEdgeRanges( [&](const TFFile::Intervals & froms, const TFFile::Intervals & tos, const QString &) {
+        foreach( const TFFile::Interval & from, froms ) {
+            for(unsigned int node = from.first; node <= from.second; node++) {
+                auto it = std::upper_bound( ranges.constBegin(), ranges.constEnd(), node, [](unsigned int n, const QPair<QPair<unsigned int,unsigned int>,QString> & range) {
+                    return n < range.first.first;
+                } );
+                if( it == ranges.constBegin() ) {
+                    continue;
+                }
+                --it;
+                if( node > it->first.second ) {
+                    continue;
+                }
+                QVector<Span> & spans = mSpans[ it->second ];
+                foreach( const TFFile::Interval & to, tos ) {
+                    Span span;
+                    span.start = to.first;
+                    span.end = to.second;
+                    span.node = node;
+                    spans << span;
+                }
+            }
+        }
+    } );
+
+    /// oslots is nearly in slot order already; where spans of a level overlap, the later node wins
+    foreach( QString level, levels ) {
+        QVector<Span> & spans = mSpans[level];
+        std::stable_sort( spans.begin(), spans.end(), [](const Span & a, const Span & b) {
+            return a.start < b.start;
+        } );
+    }
+}
+
+QList<NodeSelection::Interval> WordContext::chunks() const
+{
+    /// a chunk per book, or failing that even slices of the slots. Books tile the
+    /// slots end to end, so they must not be merged into one interval; they are
+    /// only trimmed where they overlap, so that no two chunks share a slot.
+    QList<NodeSelection::Interval> bookRanges;
+    if( mSpans.contains("book") ) {
+        foreach( const Span & span, mSpans.value("book") ) {
+            bookRanges << NodeSelection::Interval( qMax( span.start, mSlotRange.first ), qMin( span.end, mSlotRange.second ) );
+        }
+        std::sort( bookRanges.begin(), bookRanges.end() );
+    }
+
+    /// slots outside of every book still need a chunk
+    QList<NodeSelection::Interval> result;
+    unsigned int next = mSlotRange.first;
+    foreach( NodeSelection::Interval range, bookRanges ) {
+        range.first = qMax( range.first, next );
+        if( range.first > range.second ) {
+            continue;
+        }
+        if( range.first > next ) {
+            result << NodeSelection::Interval( next, range.first - 1 );
+        }
+        result << range;
+        next = range.second + 1;
+    }
+    const unsigned int sliceSize = 65536;
+    while( next <= mSlotRange.second ) {
+        const unsigned int last = qMin( mSlotRange.second, next + sliceSize - 1 );
+        result << NodeSelection::Interval( next, last );
+        next = last + 1;
+    }
+    return result;
+}
+
+void WordContext::fill(const QVector<Span> &spans, const QVector<unsigned int> &reach, std::vector<unsigned int> &ancestors, unsigned int first, unsigned int last) const
+{
+    /// the first span that reaches this chunk; every span before it ends earlier
+    int i = static_cast<int>( std::lower_bound( reach.constBegin(), reach.constEnd(), first ) - reach.constBegin() );
+    for( ; i < spans.count() && spans.at(i).start <= last; i++ ) {
+        const Span & span = spans.at(i);
+        if( span.end < first ) {
+            continue;
+        }
+        const unsigned int from = qMax( span.start, first );
+        const unsigned int to = qMin( span.end, last );
+        for(unsigned int slot = from; slot <= to; slot++) {
+            ancestors[ slot - mSlotRange.first ] = span.node;
+        }
+    }
+}
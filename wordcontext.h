@@ -0,0 +1,56 @@
+#ifndef WORDCONTEXT_H
+#define WORDCONTEXT_H
+
+#include <QDir>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+#include <vector>
+
+#include "nodeselection.h"
+
+class AbstractDatabaseAdapter;
+
+/// Builds the <slot type>_context table (word_context, in the BHSA): a row for
+/// every slot, with the id of the node that contains it at each of the given
+/// levels (phrase, clause, ...), so that finding the clause or verse of a word
+/// is a lookup in an indexed column instead of a join through oslots.
+class WordContext
+{
+public:
+    WordContext(const QDir & folder, AbstractDatabaseAdapter * db, const QHash<QString,QPair<unsigned int,unsigned int>> & oTypeRanges);
+
+    /// only write rows for the slots in @selection
+    void setSelection(const NodeSelection & selection);
+
+    void build(const QStringList & levels);
+
+    QString tableName() const;
+
+private:
+    /// one stretch of the slots of a node
+    struct Span {
+        unsigned int start;
+        unsigned int end;
+        unsigned int node;
+    };
+
+    void loadSpans(const QStringList & levels);
+    QList<NodeSelection::Interval> chunks() const;
+    /// assign the nodes of one level to the slots in [@first, @last]
+    void fill(const QVector<Span> & spans, const QVector<unsigned int> & reach, std::vector<unsigned int> & ancestors, unsigned int first, unsigned int last) const;
+
+    QDir mFolder;
+    AbstractDatabaseAdapter * mDb;
+    QHash<QString,QPair<unsigned int,unsigned int>> mOTypeRanges;
+    QString mSlotType;
+    QPair<unsigned int,unsigned int> mSlotRange;
+    NodeSelection mSelection;
+
+    /// level -> spans sorted by start
+    QHash<QString,QVector<Span>> mSpans;
+};
+
+#endif // WORDCONTEXT_H